@@ -0,0 +1,116 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <numeric>
+
+
+namespace
+{
+    std::atomic<std::int64_t> allocationCount = 0;
+}
+
+
+// The benchmark binary counts every call of the global allocator, so the results can
+// show how many allocations one iteration makes
+void* operator new(std::size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* block = std::malloc(size == 0 ? 1 : size))
+        return block;
+    throw std::bad_alloc();
+}
+
+
+void operator delete(void* block) noexcept
+{
+    std::free(block);
+}
+
+
+void operator delete(void* block, std::size_t) noexcept
+{
+    std::free(block);
+}
+
+
+void BenchmarkSuite::add(std::string name, Body body)
+{
+    m_cases.push_back({ std::move(name), std::move(body) });
+}
+
+
+void BenchmarkSuite::run(const std::string& filter, double minSeconds, int samples)
+{
+    for (const auto& benchCase : m_cases)
+    {
+        if (benchCase.name.find(filter) == std::string::npos)
+            continue;
+        std::cerr << "running " << benchCase.name << "...\n";
+        m_results.push_back(measure(benchCase, minSeconds, samples));
+    }
+}
+
+
+BenchmarkSuite::Result BenchmarkSuite::measure(const Case& benchCase, double minSeconds, int samples) const
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto timeBatch = [&](std::int64_t count)
+    {
+        const auto start = Clock::now();
+        for (std::int64_t i = 0; i < count; ++i)
+            benchCase.body();
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+
+    // Grow the batch until a single sample takes its share of the minimal time
+    const double sampleNs = minSeconds * 1e9 / samples;
+    std::int64_t batch = 1;
+    for (double elapsed = timeBatch(batch); elapsed < sampleNs && batch < (std::int64_t{ 1 } << 40);)
+    {
+        const double factor = elapsed > 0 ? std::clamp(sampleNs / elapsed * 1.2, 2.0, 100.0) : 100.0;
+        batch = static_cast<std::int64_t>(static_cast<double>(batch) * factor);
+        elapsed = timeBatch(batch);
+    }
+
+    auto perIteration = std::vector<double>(static_cast<std::size_t>(samples));
+    const auto allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    for (auto& sample : perIteration)
+        sample = timeBatch(batch) / static_cast<double>(batch);
+    const auto allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+    std::ranges::sort(perIteration);
+
+    auto result = Result();
+    result.name = benchCase.name;
+    result.iterations = batch * samples;
+    result.meanNs = std::accumulate(perIteration.begin(), perIteration.end(), 0.0) / samples;
+    result.medianNs = perIteration[perIteration.size() / 2];
+    result.minNs = perIteration.front();
+    result.maxNs = perIteration.back();
+    result.allocations = static_cast<double>(allocations) / static_cast<double>(result.iterations);
+    return result;
+}
+
+
+void BenchmarkSuite::writeJson(std::ostream& ostr) const
+{
+    ostr << "{\n  \"suite\": \"oop2_ex03\",\n  \"unit\": \"ns\",\n  \"benchmarks\": [";
+    for (decltype(m_results.size()) i = 0; i < m_results.size(); ++i)
+    {
+        const auto& result = m_results[i];
+        ostr << (i == 0 ? "\n" : ",\n")
+             << "    { \"name\": \"" << result.name << "\""
+             << ", \"iterations\": " << result.iterations
+             << ", \"mean\": " << result.meanNs
+             << ", \"median\": " << result.medianNs
+             << ", \"min\": " << result.minNs
+             << ", \"max\": " << result.maxNs
+             << ", \"allocations\": " << result.allocations << " }";
+    }
+    ostr << "\n  ]\n}\n";
+}
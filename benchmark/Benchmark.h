@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <iosfwd>
+#include <streambuf>
+#include <cstdint>
+
+
+// Keeps the optimizer from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+
+// Stream buffer that swallows everything, used to time the text paths without a terminal
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+
+// Collects named workloads, runs each until the minimal time is reached and
+// reports the per-iteration timings as JSON
+class BenchmarkSuite
+{
+public:
+    // One call of the function is one iteration
+    using Body = std::function<void()>;
+
+    struct Result
+    {
+        std::string name;
+        std::int64_t iterations = 0;
+        double meanNs = 0;
+        double medianNs = 0;
+        double minNs = 0;
+        double maxNs = 0;
+        double allocations = 0;     // calls of the global operator new per iteration
+    };
+
+    void add(std::string name, Body body);
+
+    // Runs every benchmark whose name contains filter
+    void run(const std::string& filter, double minSeconds, int samples);
+
+    void writeJson(std::ostream& ostr) const;
+
+private:
+    struct Case
+    {
+        std::string name;
+        Body body;
+    };
+
+    Result measure(const Case& benchCase, double minSeconds, int samples) const;
+
+    std::vector<Case> m_cases;
+    std::vector<Result> m_results;
+};
+
+
+void registerMatrixBenchmarks(BenchmarkSuite& suite);
+void registerOperationBenchmarks(BenchmarkSuite& suite);
+void registerStreamBenchmarks(BenchmarkSuite& suite);
+void registerScriptBenchmarks(BenchmarkSuite& suite);
+void registerPipelineBenchmarks(BenchmarkSuite& suite);
+void registerLibraryBenchmarks(BenchmarkSuite& suite);
@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+#include "OperationLibrary.h"
+#include "Add.h"
+#include "Comp.h"
+#include "Identity.h"
+#include "Scalar.h"
+#include "Sub.h"
+#include "Transpose.h"
+
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+
+
+namespace
+{
+    // Operation list of count entries where every new entry reuses earlier ones,
+    // so the snapshot is a heavily shared DAG rather than a set of trees
+    OperationLibrary::OperationList makeLibrary(int count)
+    {
+        auto generator = std::mt19937_64(count);
+        auto operations = OperationLibrary::OperationList{
+            std::make_shared<Identity>(), std::make_shared<Transpose>(), std::make_shared<Scalar>(2) };
+        while (static_cast<int>(operations.size()) < count)
+        {
+            auto pick = std::uniform_int_distribution<std::size_t>(0, operations.size() - 1);
+            const auto& first = operations[pick(generator)];
+            const auto& second = operations[pick(generator)];
+            switch (generator() % 4)
+            {
+            case 0: operations.push_back(std::make_shared<Add>(first, second)); break;
+            case 1: operations.push_back(std::make_shared<Sub>(first, second)); break;
+            case 2: operations.push_back(std::make_shared<Comp>(first, second)); break;
+            default: operations.push_back(std::make_shared<Scalar>(static_cast<int>(generator() % 9) - 4)); break;
+            }
+        }
+        return operations;
+    }
+}
+
+
+void registerLibraryBenchmarks(BenchmarkSuite& suite)
+{
+    for (int count : { 100, 10000 })
+    {
+        const auto library = makeLibrary(count);
+        const auto path = (std::filesystem::temp_directory_path()
+            / ("oop2_ex03_bench_" + std::to_string(count) + ".lib")).string();
+        // The load case reads the file written here, whichever cases are filtered in
+        OperationLibrary::save(path, library);
+
+        suite.add("library/save/" + std::to_string(count),
+            [=] { OperationLibrary::save(path, library); });
+        suite.add("library/load/" + std::to_string(count),
+            [=] { doNotOptimize(OperationLibrary::load(path)); });
+    }
+}
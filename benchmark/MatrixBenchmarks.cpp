@@ -0,0 +1,83 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "StructuredMatrix.h"
+
+#include <cstdint>
+#include <string>
+
+
+namespace
+{
+    // add and scal of one element type and range policy, to compare the SIMD width and check cost
+    template <typename T, typename Policy>
+    void registerElementType(BenchmarkSuite& suite, const std::string& typeName, int size)
+    {
+        const auto suffix = "/" + typeName + "/" + std::to_string(size);
+        const auto lhs = SquareMatrix<T, Policy>(size, T(1));
+        const auto rhs = SquareMatrix<T, Policy>(size, T(2));
+
+        suite.add("matrix/add" + suffix, [=] { doNotOptimize(lhs + rhs); });
+        suite.add("matrix/scal" + suffix, [=] { doNotOptimize(lhs * T(3)); });
+    }
+
+    template <typename Policy>
+    void registerElementTypes(BenchmarkSuite& suite, const std::string& policyName)
+    {
+        registerElementType<std::int16_t, Policy>(suite, "int16_" + policyName, 512);
+        registerElementType<std::int32_t, Policy>(suite, "int32_" + policyName, 512);
+        registerElementType<std::int64_t, Policy>(suite, "int64_" + policyName, 512);
+        registerElementType<float, Policy>(suite, "float_" + policyName, 512);
+        registerElementType<double, Policy>(suite, "double_" + policyName, 512);
+    }
+
+    // Dense matrix holding the given structure, with small values
+    SquareMatrix<int> makeShaped(int size, const std::string& shape)
+    {
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                const bool stored = shape == "diagonal" ? i == j
+                                  : shape == "upper" ? i <= j
+                                  : shape == "sparse" ? (i * 31 + j * 17) % 100 == 0
+                                  : true;
+                if (stored)
+                    matrix(i, j) = 1 + (i + j) % 3;
+            }
+        }
+        return matrix;
+    }
+}
+
+
+void registerMatrixBenchmarks(BenchmarkSuite& suite)
+{
+    for (int size : { 5, 32, 128, 512 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        // Small values so that no operation leaves the allowed range
+        const auto lhs = SquareMatrix<int>(size, 1);
+        const auto rhs = SquareMatrix<int>(size, 2);
+
+        suite.add("matrix/add" + suffix, [=] { doNotOptimize(lhs + rhs); });
+        suite.add("matrix/sub" + suffix, [=] { doNotOptimize(lhs - rhs); });
+        suite.add("matrix/scal" + suffix, [=] { doNotOptimize(lhs * 3); });
+        suite.add("matrix/transpose" + suffix, [=] { doNotOptimize(lhs.Transpose()); });
+    }
+
+    registerElementTypes<CalculatorRange>(suite, "checked");
+    registerElementTypes<Unchecked>(suite, "unchecked");
+
+    // The same operations on a structured representation, next to the dense ones above
+    for (const std::string shape : { "diagonal", "upper", "symmetric", "sparse" })
+    {
+        const auto dense = makeShaped(512, shape);
+        const auto lhs = StructuredMatrix<int>::fromDense(dense);
+        const auto suffix = "/" + shape + "/512";
+
+        suite.add("structured/add" + suffix, [=] { doNotOptimize(lhs + lhs); });
+        suite.add("structured/scal" + suffix, [=] { doNotOptimize(lhs * 3); });
+        suite.add("structured/transpose" + suffix, [=] { doNotOptimize(lhs.Transpose()); });
+    }
+}
@@ -0,0 +1,135 @@
+#include "Benchmark.h"
+#include "Add.h"
+#include "Comp.h"
+#include "EvalSession.h"
+#include "Identity.h"
+#include "Scratch.h"
+#include "Scalar.h"
+#include "Transpose.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    // ((tran -> scal 1) -> tran) -> ... with depth unary stages
+    std::shared_ptr<Operation> makeCompChain(int depth)
+    {
+        std::shared_ptr<Operation> chain = std::make_shared<Transpose>();
+        for (int i = 1; i < depth; ++i)
+        {
+            if (i % 2 == 0)
+                chain = std::make_shared<Comp>(chain, std::make_shared<Transpose>());
+            else
+                chain = std::make_shared<Comp>(chain, std::make_shared<Scalar>(1));
+        }
+        return chain;
+    }
+
+    // Balanced tree of additions over 2^levels identity leaves
+    std::shared_ptr<Operation> makeAddTree(int levels)
+    {
+        if (levels == 0)
+            return std::make_shared<Identity>();
+        return std::make_shared<Add>(makeAddTree(levels - 1), makeAddTree(levels - 1));
+    }
+}
+
+
+void registerOperationBenchmarks(BenchmarkSuite& suite)
+{
+    for (int depth : { 16, 64, 256 })
+    {
+        for (int size : { 5, 64 })
+        {
+            const auto chain = makeCompChain(depth);
+            const auto input = std::vector<Operation::T>(1, Operation::T(size, 1));
+            suite.add("compute/comp_chain/" + std::to_string(depth) + "/" + std::to_string(size),
+                [=] { doNotOptimize(chain->compute(input)); });
+        }
+    }
+
+    for (int levels : { 3, 6, 8 })
+    {
+        const auto tree = makeAddTree(levels);
+        // Zero leaves keep the sum in range regardless of the width
+        const auto input = std::vector<Operation::T>(tree->inputCount(), Operation::T(5, 0));
+        suite.add("compute/add_tree/" + std::to_string(tree->inputCount()) + "/5",
+            [=] { doNotOptimize(tree->compute(input)); });
+    }
+
+    // One input changes between runs: the session recomputes the path to the root only
+    for (int levels : { 3, 6, 8 })
+    {
+        const auto tree = makeAddTree(levels);
+        const auto session = std::make_shared<EvalSession>(tree, std::vector<Operation::T>(tree->inputCount(), Operation::T(5, 0)));
+        session->recompute();
+        const auto values = std::make_shared<int>(0);
+        suite.add("session/update_one/" + std::to_string(tree->inputCount()) + "/5",
+            [=] {
+                *values ^= 1;
+                session->setInput(0, Operation::T(5, *values));
+                doNotOptimize(session->recompute());
+            });
+    }
+
+    // The same trees through computeInto, reusing one result and one scratch block:
+    // the steady state makes no allocations
+    const auto addIntoCases = [&suite](const std::string& name, const std::shared_ptr<Operation>& operation, int size, int value)
+    {
+        const auto inputs = std::make_shared<const std::vector<Operation::T>>(operation->inputCount(), Operation::T(size, value));
+        const auto views = std::make_shared<const std::vector<Operation::ConstRef>>(inputs->begin(), inputs->end());
+        const auto result = std::make_shared<Operation::T>(size, 0);
+        const auto scratch = std::make_shared<Scratch>(operation->scratchBytes(size));
+        suite.add("compute_into/" + name + "/" + std::to_string(size),
+            [=] {
+                operation->computeInto(*views, *result, *scratch);
+                doNotOptimize(*result);
+                (void)inputs;
+            });
+    };
+    for (int depth : { 16, 64, 256 })
+    {
+        for (int size : { 5, 64 })
+            addIntoCases("comp_chain/" + std::to_string(depth), makeCompChain(depth), size, 1);
+    }
+    for (int levels : { 3, 6, 8 })
+    {
+        const auto tree = makeAddTree(levels);
+        addIntoCases("add_tree/" + std::to_string(tree->inputCount()), tree, 5, 0);
+    }
+
+    // Every set overflows at the first addition: the cost of reporting the error by
+    // exception against the status returned by the non-throwing API
+    for (int levels : { 1, 6 })
+    {
+        const auto tree = makeAddTree(levels);
+        const auto inputs = std::vector<Operation::T>(tree->inputCount(), Operation::T(5, 600));
+        const auto views = std::make_shared<const std::vector<Operation::ConstRef>>(inputs.begin(), inputs.end());
+        const auto result = std::make_shared<Operation::T>(5, 0);
+        const auto scratch = std::make_shared<Scratch>(tree->scratchBytes(5));
+        const auto name = "add_tree/" + std::to_string(tree->inputCount()) + "/5";
+        suite.add("overflow/exception/" + name, [=]
+            {
+                try
+                {
+                    tree->computeInto(*views, *result, *scratch);
+                }
+                catch (const std::out_of_range& e)
+                {
+                    doNotOptimize(e);
+                }
+            });
+        suite.add("overflow/status/" + name, [=]
+            {
+                doNotOptimize(tree->tryComputeInto(*views, *result, *scratch));
+            });
+        suite.add("overflow/expected/" + name, [=]
+            {
+                doNotOptimize(tree->tryCompute(inputs));
+            });
+    }
+}
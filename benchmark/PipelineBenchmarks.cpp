@@ -0,0 +1,100 @@
+#include "Benchmark.h"
+#include "Add.h"
+#include "EvalPipeline.h"
+#include "Identity.h"
+#include "Scalar.h"
+#include "Topology.h"
+#include "Transpose.h"
+
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    constexpr int setCount = 2048;
+    constexpr int size = 5;
+
+    std::string makeSets(int inputCount, int matrixSize = size, int sets = setCount)
+    {
+        auto text = std::ostringstream();
+        for (int set = 0; set < sets * inputCount; ++set)
+        {
+            for (int i = 0; i < matrixSize * matrixSize; ++i)
+                text << (i == 0 ? "" : " ") << (set + i) % 7;
+            text << '\n';
+        }
+        return text.str();
+    }
+}
+
+
+void registerPipelineBenchmarks(BenchmarkSuite& suite)
+{
+    const std::shared_ptr<Operation> operation = std::make_shared<Add>(
+        std::make_shared<Add>(std::make_shared<Identity>(), std::make_shared<Scalar>(2)),
+        std::make_shared<Transpose>());
+    const auto sets = makeSets(operation->inputCount());
+
+    // The same work on one thread, one set after the other like eval does
+    suite.add("pipeline/sequential/" + std::to_string(setCount), [=]
+    {
+        auto in = std::istringstream(sets);
+        auto buffer = NullBuffer();
+        auto out = std::ostream(&buffer);
+        for (int set = 0; set < setCount; ++set)
+        {
+            auto input = std::vector<Operation::T>();
+            for (int i = 0; i < operation->inputCount(); ++i)
+            {
+                input.emplace_back(size);
+                in >> input.back();
+            }
+            out << '\n';
+            operation->print(out, input);
+            out << " = \n" << operation->compute(input);
+        }
+    });
+
+    for (int workers : { 1, 2, 4 })
+    {
+        suite.add("pipeline/threads_" + std::to_string(workers) + "/" + std::to_string(setCount), [=]
+        {
+            auto in = std::istringstream(sets);
+            auto buffer = NullBuffer();
+            auto out = std::ostream(&buffer);
+            doNotOptimize(EvalPipeline(*operation, size, { workers, 256 }).run(in, out, setCount));
+        });
+    }
+
+    // Pinned workers with node-local buffers and L2-sized batches against free-floating
+    // workers taking one set at a time. The worker counts step through the NUMA nodes
+    // (one worker per node, then two), so on a multi-socket machine the pairs show how
+    // each placement scales once the work crosses sockets
+    const int nodes = Topology::current().nodeCount();
+    auto workerCounts = std::vector<int>{ 1, nodes, 2 * nodes, 4 * nodes };
+    std::ranges::sort(workerCounts);
+    workerCounts.erase(std::unique(workerCounts.begin(), workerCounts.end()), workerCounts.end());
+    for (const int matrixSize : { size, 48 })
+    {
+        const int count = matrixSize == size ? setCount : 256;
+        const auto text = makeSets(operation->inputCount(), matrixSize, count);
+        for (const int workers : workerCounts)
+        {
+            for (const bool placement : { false, true })
+            {
+                suite.add("pipeline/placement_" + std::string(placement ? "on" : "off") + "/threads_" + std::to_string(workers)
+                          + "/" + std::to_string(matrixSize) + "/" + std::to_string(count), [=]
+                {
+                    auto in = std::istringstream(text);
+                    auto buffer = NullBuffer();
+                    auto out = std::ostream(&buffer);
+                    doNotOptimize(EvalPipeline(*operation, matrixSize, { workers, 256, placement }).run(in, out, count));
+                });
+            }
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#include "Benchmark.h"
+#include "FunctionCalculator.h"
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    // A session that defines operations and evaluates each of them once on 5x5 matrices
+    std::string makeScript(int operationCount)
+    {
+        auto script = std::ostringstream();
+        auto inputCounts = std::vector<int>{ 1, 1 };
+        script << "100\n";
+        for (int i = 2; i < operationCount; ++i)
+        {
+            const int previous = inputCounts.back();
+            switch (i % 4)
+            {
+            case 0: script << "scal " << (i % 3) - 1 << '\n'; inputCounts.push_back(1); break;
+            case 1: script << "add " << i - 1 << " 0\n"; inputCounts.push_back(previous + 1); break;
+            case 2: script << "comp " << i - 1 << " 1\n"; inputCounts.push_back(previous); break;
+            default: script << "sub " << i - 1 << " 1\n"; inputCounts.push_back(previous + 1); break;
+            }
+        }
+        for (int i = 0; i < operationCount; ++i)
+        {
+            script << "eval " << i << " 5\n";
+            for (int matrix = 0; matrix < inputCounts[i]; ++matrix)
+            {
+                // eval expects the line to end right after the last element
+                for (int j = 0; j < 25; ++j)
+                    script << (j == 0 ? "" : " ") << (j % 3);
+                script << '\n';
+            }
+        }
+        script << "exit\n";
+        return script.str();
+    }
+}
+
+
+void registerScriptBenchmarks(BenchmarkSuite& suite)
+{
+    for (int operationCount : { 10, 40 })
+    {
+        const auto script = makeScript(operationCount);
+        suite.add("script/replay/" + std::to_string(operationCount), [=]
+        {
+            auto in = std::istringstream(script);
+            auto buffer = NullBuffer();
+            auto out = std::ostream(&buffer);
+            FunctionCalculator(in, out).run();
+        });
+    }
+}
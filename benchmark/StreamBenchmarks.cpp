@@ -0,0 +1,35 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+
+#include <sstream>
+#include <string>
+
+
+void registerStreamBenchmarks(BenchmarkSuite& suite)
+{
+    for (int size : { 5, 64 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+
+        auto text = std::ostringstream();
+        for (int i = 0; i < size * size; ++i)
+            text << (i % 2000) - 1024 << ' ';
+        const auto matrixText = text.str();
+
+        suite.add("stream/read" + suffix, [=]
+        {
+            auto in = std::istringstream(matrixText);
+            auto matrix = SquareMatrix<int>(size);
+            in >> matrix;
+            doNotOptimize(matrix);
+        });
+
+        const auto matrix = SquareMatrix<int>(size, -123);
+        suite.add("stream/write" + suffix, [=]
+        {
+            auto buffer = NullBuffer();
+            auto out = std::ostream(&buffer);
+            out << matrix;
+        });
+    }
+}
@@ -0,0 +1,72 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+
+// Usage: oop2_ex03_bench [--filter text] [--min-time seconds] [--samples count] [--out file.json]
+int main(int argc, char* argv[])
+{
+    auto filter = std::string();
+    auto outPath = std::string();
+    double minSeconds = 0.5;
+    int samples = 5;
+
+    constexpr auto usage = "Usage: oop2_ex03_bench [--filter text] [--min-time seconds] [--samples count] [--out file.json]";
+    for (int i = 1; i < argc; i += 2)
+    {
+        const auto option = std::string(argv[i]);
+        if (i + 1 == argc)
+        {
+            std::cerr << "Missing value for option: " << option << '\n' << usage << '\n';
+            return 1;
+        }
+        try
+        {
+            if (option == "--filter")
+                filter = argv[i + 1];
+            else if (option == "--min-time")
+                minSeconds = std::stod(argv[i + 1]);
+            else if (option == "--samples")
+                samples = std::max(1, std::stoi(argv[i + 1]));
+            else if (option == "--out")
+                outPath = argv[i + 1];
+            else
+            {
+                std::cerr << "Unknown option: " << option << '\n' << usage << '\n';
+                return 1;
+            }
+        }
+        catch (const std::logic_error&)
+        {
+            // std::invalid_argument and std::out_of_range from the number conversions
+            std::cerr << "Invalid value for option " << option << ": " << argv[i + 1] << '\n' << usage << '\n';
+            return 1;
+        }
+    }
+
+    auto suite = BenchmarkSuite();
+    registerMatrixBenchmarks(suite);
+    registerOperationBenchmarks(suite);
+    registerStreamBenchmarks(suite);
+    registerScriptBenchmarks(suite);
+    registerPipelineBenchmarks(suite);
+    registerLibraryBenchmarks(suite);
+    suite.run(filter, minSeconds, samples);
+
+    if (outPath.empty())
+    {
+        suite.writeJson(std::cout);
+        return 0;
+    }
+    auto file = std::ofstream(outPath);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << outPath << '\n';
+        return 1;
+    }
+    suite.writeJson(file);
+}
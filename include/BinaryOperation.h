@@ -5,18 +5,25 @@
 #include <memory>
 
 
-class BinaryOperation : public Operation
+template <typename M>
+class BasicBinaryOperation : public BasicOperation<M>
 {
 public:
-    BinaryOperation(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2);
-	int inputCount() const override { return m_first->inputCount() + m_second->inputCount(); }
+    using OperationPtr = std::shared_ptr<BasicOperation<M>>;
+
+    BasicBinaryOperation(const OperationPtr& arg1, const OperationPtr& arg2);
+	int inputCount() const override { return m_inputCount; }
+    std::vector<const OperationBase*> children() const override { return { m_first.get(), m_second.get() }; }
 protected:
-    const std::shared_ptr<Operation>& first() const { return m_first; }
-    const std::shared_ptr<Operation>& second() const { return m_second; }
+    const OperationPtr& first() const { return m_first; }
+    const OperationPtr& second() const { return m_second; }
     virtual void printSymbol(std::ostream& ostr) const = 0;
     void print(std::ostream& ostr, bool first_print =false) const override;
 
 private:
-    const std::shared_ptr<Operation> m_first;
-    const std::shared_ptr<Operation> m_second;
+    const OperationPtr m_first;
+    const OperationPtr m_second;
+    // The children never change, so the count is computed once instead of walking
+    // the (possibly heavily shared) subtrees on every call
+    const int m_inputCount;
 };
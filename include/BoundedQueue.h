@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <utility>
+
+
+// Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's array queue).
+// Every cell carries a sequence number telling whether it is ready for the next push or pop,
+// so producers and consumers only contend on their own index.
+// push()/pop() spin and then yield while the queue is full/empty, which is what gives
+// the stages of a pipeline their backpressure.
+template <typename T>
+class BoundedQueue
+{
+public:
+    // The capacity is rounded up to a power of two
+    explicit BoundedQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+            size *= 2;
+        m_mask = size - 1;
+        m_cells = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    std::size_t capacity() const { return m_mask + 1; }
+
+    // Moves from value only when it returns true
+    bool tryPush(T& value)
+    {
+        auto position = m_enqueue.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = m_cells[position & m_mask];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0)
+            {
+                if (m_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;   // full
+            }
+            else
+            {
+                position = m_enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool tryPop(T& value)
+    {
+        auto position = m_dequeue.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = m_cells[position & m_mask];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (difference == 0)
+            {
+                if (m_dequeue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.sequence.store(position + m_mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+            {
+                return false;   // empty
+            }
+            else
+            {
+                position = m_dequeue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void push(T value)
+    {
+        for (int attempt = 0; !tryPush(value); ++attempt)
+            backoff(attempt);
+    }
+
+    T pop()
+    {
+        auto value = T();
+        for (int attempt = 0; !tryPop(value); ++attempt)
+            backoff(attempt);
+        return value;
+    }
+
+    static void backoff(int attempt)
+    {
+        if (attempt > 64)
+            std::this_thread::yield();
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    static constexpr std::size_t cacheLine = 64;
+
+    std::unique_ptr<Cell[]> m_cells;
+    std::size_t m_mask = 0;
+    alignas(cacheLine) std::atomic<std::size_t> m_enqueue = 0;
+    alignas(cacheLine) std::atomic<std::size_t> m_dequeue = 0;
+};
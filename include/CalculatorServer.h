@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Operation.h"
+#include "OperationRegistry.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Long-lived calculator that serves many clients over a local Unix domain socket.
+// One epoll event loop accepts connections, reads request frames (see Protocol.h),
+// runs them against the shared operation list and writes the responses back.
+// Requests are tiny, so they are handled on the loop thread as soon as a frame is
+// complete; a slow client only delays itself because all sockets are non-blocking.
+// Linux only, elsewhere run() throws std::runtime_error.
+class CalculatorServer
+{
+public:
+    using OperationList = OperationRegistry::OperationList;
+
+    // Service time of the handled requests in power of two nanosecond buckets
+    class LatencyStats
+    {
+    public:
+        void record(std::int64_t ns, bool failed);
+        void print(std::ostream& ostr) const;
+
+    private:
+        // Upper bound of the bucket holding the given fraction of the requests
+        std::int64_t percentile(double fraction) const;
+
+        std::array<std::int64_t, 64> m_buckets{};
+        std::int64_t m_count = 0;
+        std::int64_t m_errors = 0;
+        std::int64_t m_totalNs = 0;
+        std::int64_t m_maxNs = 0;
+    };
+
+    CalculatorServer(std::string socketPath, OperationList operations);
+    ~CalculatorServer();
+    CalculatorServer(const CalculatorServer&) = delete;
+    CalculatorServer& operator=(const CalculatorServer&) = delete;
+
+    // Serves until stop() is called or a client sends "shutdown"
+    void run();
+
+    // Safe to call from any thread or a signal handler
+    void stop();
+
+    // Runs one request payload and returns the response payload
+    std::string handle(const std::string& request);
+
+private:
+    struct Connection
+    {
+        std::string input;
+        std::string output;
+        std::size_t written = 0;
+        bool writing = false;               // registered for EPOLLOUT
+        bool paused = false;                // not registered for EPOLLIN, too much output is pending
+    };
+
+    void execute(std::istream& in, std::ostream& out);
+    void evalRequest(std::istream& in, std::ostream& out) const;
+    void listRequest(std::ostream& out) const;
+    std::size_t readIndex(std::istream& in) const;
+
+    void acceptClients();
+    // Accepts one pending connection and closes it, when no descriptor is left for it
+    bool shedClient();
+    void readClient(int fd, Connection& connection);
+    void answerClient(int fd, Connection& connection);
+    // Sends what it can of the pending output, returns false when the client was closed
+    bool writeClient(int fd, Connection& connection);
+    void closeClient(int fd);
+
+    std::string m_socketPath;
+    OperationRegistry m_operations;
+    std::size_t m_evalLimit = 0;            // bytes one eval request may use, 0 for no limit
+    LatencyStats m_stats;
+    std::unordered_map<int, Connection> m_connections;
+    std::int64_t m_acceptedConnections = 0;
+    std::int64_t m_droppedConnections = 0;
+
+    int m_listenFd = -1;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    int m_reserveFd = -1;                   // kept open to be closed when descriptors run out
+    std::atomic<bool> m_running = false;
+};
+
+
+// Sends every non-empty line of in as one request and writes the responses to out.
+// Returns the number of requests that failed.
+int runCalculatorClient(const std::string& socketPath, std::istream& in, std::ostream& out);
@@ -1,17 +1,43 @@
 #pragma once
 
 #include "BinaryOperation.h"
+#include "LinearMap.h"
 
 #include <string>
 #include <memory>
+#include <optional>
 
 
-class Comp : public BinaryOperation
+template <typename M>
+class BasicComp : public BasicBinaryOperation<M>
 {
 public:
-    using BinaryOperation::BinaryOperation;
+    using T = typename BasicOperation<M>::T;
+    using S = typename BasicOperation<M>::S;
+    using Ref = typename BasicOperation<M>::Ref;
+    using ConstRef = typename BasicOperation<M>::ConstRef;
+    using OperationPtr = typename BasicBinaryOperation<M>::OperationPtr;
+    using Linear = LinearMap<typename M::value_type, typename M::policy_type>;
+
+    BasicComp(const OperationPtr& arg1, const OperationPtr& arg2);
     int inputCount() const override;
+    OperationBase::Kind kind() const override { return OperationBase::Kind::Comp; }
+    bool foldsChildren() const override { return m_linear.has_value(); }
+    std::size_t objectBytes() const override;
     T compute(const std::vector<T>& input) const override;
+    S computeStructured(const std::vector<S>& input) const override;
+    std::optional<EvalFault> tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const override;
+    std::size_t scratchBytes(int size) const override;
     void printSymbol(std::ostream& ostr) const override;
-   
+
+    // The normal form when the whole composition is made of scal, tran and id stages
+    const std::optional<Linear>& linearMap() const { return m_linear; }
+
+private:
+    // Normal form of one operation, if it has one
+    static std::optional<Linear> linearMapOf(const BasicOperation<M>& operation);
+
+    std::optional<Linear> m_linear;
 };
+
+using Comp = BasicComp<Operation::T>;
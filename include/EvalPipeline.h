@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+// Evaluates a stream of input sets for one operation in three overlapping stages:
+// a parser thread reads the sets, a pool of evaluator threads runs compute and the
+// calling thread formats the results in input order.
+// The stages are connected by bounded lock-free queues, so a fast stage waits for the
+// slow one instead of buffering without limit.
+// With placement on, every evaluator is pinned to a CPU (spread over the NUMA nodes)
+// and takes the sets in batches that fit its L2 cache. The parser then only cuts the
+// text of every set out of the stream; the evaluator parses it and allocates the
+// inputs, the results and its scratch itself, so the first touch puts them all on its
+// own node without copying anything.
+class EvalPipeline
+{
+public:
+    struct Options
+    {
+        int workers = 0;                    // 0 uses one thread per hardware thread (minus the parser)
+        std::size_t queueCapacity = 256;
+        bool placement = true;
+    };
+
+    // Time every stage spent doing its own work (not waiting on a queue)
+    struct Stats
+    {
+        int sets = 0;
+        int errors = 0;
+        std::int64_t totalNs = 0;
+        std::int64_t parseNs = 0;           // with placement, plus the parsing on the evaluators
+        std::int64_t computeNs = 0;         // summed over the evaluator threads
+        std::int64_t formatNs = 0;
+        int workers = 0;
+        int pinned = 0;                     // evaluators the system let pin to their CPU
+        int batchSize = 1;                  // sets an evaluator takes at once
+    };
+
+    EvalPipeline(const Operation& operation, int size, Options options);
+
+    // Evaluator threads run() starts
+    int workers() const { return m_options.workers; }
+
+    // Reads count input sets of inputCount() matrices (every matrix ends its line, its rows may
+    // be on lines of their own) and writes every result
+    Stats run(std::istream& in, std::ostream& out, int count);
+
+private:
+    struct Set
+    {
+        std::vector<Operation::T> input;
+        std::string text;                   // with placement, the unparsed matrices of the set, one per line
+        std::string error;
+    };
+
+    // Consecutive sets starting at index
+    struct Job
+    {
+        int index = -1;                     // -1 tells an evaluator to stop
+        std::vector<Set> sets;
+    };
+
+    struct Result
+    {
+        int index = -1;
+        std::vector<Operation::T> input;
+        std::optional<Operation::T> output; // empty when error is set
+        std::string error;
+    };
+
+    int batchSize(int count) const;
+    Set parse(std::istream& in) const;
+    // Cuts the tokens of one set out of in, for the evaluator to parse
+    Set readText(std::istream& in) const;
+    Result evaluate(int index, Set set, Scratch& scratch, std::vector<Operation::ConstRef>& views) const;
+    void format(std::ostream& out, const Result& result) const;
+
+    const Operation& m_operation;
+    int m_size;
+    Options m_options;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <compare>
+#include <memory>
+#include <vector>
+
+
+// Evaluates one operation repeatedly while its inputs change one at a time.
+// The operation tree is flattened into a list of nodes in evaluation order, each
+// knowing where its arguments come from (an input slot or an earlier node) and which
+// nodes use its result. Every node keeps its last result, so after an input changes
+// only the nodes on the path from that input to the root are computed again, and
+// the walk stops early where a recomputed result turns out to be unchanged.
+class EvalSession
+{
+public:
+    // All inputs must have the same size; nothing is computed until recompute()
+    EvalSession(std::shared_ptr<const Operation> operation, std::vector<Operation::T> inputs);
+
+    // Replaces one input, the nodes that read it are recomputed by the next recompute()
+    void setInput(int slot, Operation::T value);
+
+    // Brings every node up to date and returns how many were computed.
+    // Throws std::out_of_range like compute() when a value leaves the range; the failed
+    // nodes stay pending, so a later recompute() tries them again.
+    int recompute();
+
+    // The value of the whole operation as of the last successful recompute()
+    const Operation::T& result() const;
+
+    int nodeCount() const { return static_cast<int>(m_nodes.size()); }
+    int inputCount() const { return static_cast<int>(m_inputs.size()); }
+
+private:
+    // An argument of a node: an input slot or the result of an earlier node
+    struct Source
+    {
+        bool fromInput = true;
+        int index = 0;
+
+        auto operator<=>(const Source&) const = default;
+    };
+
+    struct Node
+    {
+        OperationBase::Kind kind = OperationBase::Kind::Identity;
+        Operation::T::value_type scalar = 0;
+        Source first;
+        Source second;                  // used by add and sub only
+        std::vector<int> users;
+        Operation::T value = Operation::T(0);
+        bool pending = true;
+        bool computed = false;
+    };
+
+    // Appends the nodes of operation, whose inputs come from arguments, and returns the root node
+    int flatten(const Operation& operation, std::vector<Source> arguments);
+    // Appends node and registers it with the sources it reads, returns its index
+    int addNode(Node node);
+    Operation::T computeNode(const Node& node) const;
+    const Operation::T& valueOf(const Source& source) const;
+
+    std::shared_ptr<const Operation> m_operation;
+    std::vector<Operation::T> m_inputs;
+    std::vector<std::vector<int>> m_inputUsers;
+    std::vector<Node> m_nodes;
+    int m_root = 0;
+};
@@ -7,8 +7,8 @@
 #include <optional>
 #include <iostream>
 
-
-class Operation;
+#include "Operation.h"
+#include "OperationRegistry.h"
 
 
 class FunctionCalculator
@@ -17,8 +17,23 @@ public:
     FunctionCalculator(std::istream& istr, std::ostream& ostr);
     void run();
 
+    // Replaces the operation list with a library written by the save command,
+    // throws std::out_of_range for a library of more than maxOperationSize operations
+    void loadLibrary(const std::string& path);
+
+    // Bounds of the operation list size
+    static constexpr int minOperationSize = 2;
+    static constexpr int maxOperationSize = 100;
+
 private:
     void eval(std::istream& in);
+    void profile(std::istream& in);
+    void trace(std::istream& in);
+    void batch(std::istream& in);
+    void save(std::istream& in);
+    void load(std::istream& in);
+    void mem();
+    void limit(std::istream& in);
     void del(std::istream& in);
     void help();
     void exit();
@@ -30,21 +45,21 @@ private:
     {
         if (auto f0 = readOperationIndex(in), f1 = readOperationIndex(in); f0 && f1)
         {
-            m_operations.push_back(std::make_shared<FuncType>(m_operations[*f0], m_operations[*f1]));
+            m_operations.add(std::make_shared<FuncType>(m_operations.at(*f0), m_operations.at(*f1)));
         }
     }
 
     template <typename FuncType>
     void unaryFunc()
     {
-    	m_operations.push_back(std::make_shared<FuncType>());
+    	m_operations.add(std::make_shared<FuncType>());
 	}
     template <typename FuncType>
     void unaryWithIntFunc(std::istream& in)
     {
         int i = 0;
         in >> i;
-        m_operations.push_back(std::make_shared<FuncType>(i));
+        m_operations.add(std::make_shared<FuncType>(i));
     }
     void printOperations() const;
 
@@ -64,6 +79,13 @@ private:
         Exit,
 		Read,
 		Resize,
+        Profile,
+        Trace,
+        Batch,
+        Save,
+        Load,
+        Mem,
+        Limit,
     };
 
     struct ActionDetails
@@ -77,14 +99,21 @@ private:
     using OperationList = std::vector<std::shared_ptr<Operation>>;
 
     const ActionMap m_actions;
-    OperationList m_operations;
+    OperationRegistry m_operations;
     bool m_running = true;
     std::istream& m_istr;
     std::ostream& m_ostr;
 	int m_operationSize = 0;
 	bool m_isMaxFunc = false;
+    std::size_t m_evalLimit = 0;            // bytes one evaluation may use, 0 for no limit
 
-    std::optional<int> readOperationIndex(std::istream& in) const;
+    std::optional<std::size_t> readOperationIndex(std::istream& in) const;
+    // The list holds m_operationSize operations already
+    bool operationListFull() const;
+    // Reads the matrix size of eval and profile
+    int readMatrixSize(std::istream& in);
+    // Reads inputCount matrices of the given size
+    std::vector<Operation::T> readMatrices(std::istream& in, int size, int inputCount);
     Action readAction(std::istream& in) const;
 
     void runAction(Action action, std::istream& in);
@@ -6,11 +6,22 @@
 // Represents the identity operation
 // Returns the same set that it gets as input
 // Used as the leaf in every operation tree
-class Identity : public UnaryOperation
+template <typename M>
+class BasicIdentity : public BasicUnaryOperation<M>
 {
 public:
-    using UnaryOperation::UnaryOperation;
+    using T = typename BasicOperation<M>::T;
+    using S = typename BasicOperation<M>::S;
+    using Ref = typename BasicOperation<M>::Ref;
+    using ConstRef = typename BasicOperation<M>::ConstRef;
+    using BasicUnaryOperation<M>::BasicUnaryOperation;
+    OperationBase::Kind kind() const override { return OperationBase::Kind::Identity; }
+    std::size_t objectBytes() const override { return sizeof(*this); }
 	T compute(const std::vector<T>& input) const override;
+	S computeStructured(const std::vector<S>& input) const override;
+	std::optional<EvalFault> tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 };
+
+using Identity = BasicIdentity<Operation::T>;
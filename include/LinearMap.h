@@ -0,0 +1,219 @@
+#pragma once
+
+#include "SquareMatrix.h"
+#include "Scratch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+
+
+// Normal form of a chain of scal, tran and id stages: every element is multiplied by
+// the scalars in order and the matrix is transposed when the chain holds an odd number
+// of transposes. Transposing only moves elements, so it commutes with the scaling and
+// with the range checks, which look at the set of values.
+//
+// For integral elements the stages fold into one multiplication. The range check a
+// checked policy does after every stage becomes one interval for the input elements:
+// stage i multiplies by s and sees prefix * x, so it succeeds exactly when every input
+// x has prefix * x within the bounds divided by s. Prefixes saturate instead of
+// overflowing; a saturated prefix only lets 0 through, as the real chain would.
+// Floating point products are not associative, so those scalars are still applied one
+// by one, but over one buffer and with at most one transpose. They are kept as a tree
+// of shared runs: appending a map links to its scalars instead of copying them, so a
+// chain of n comps, each holding its own map, still takes O(n) time and memory.
+template <typename Value, typename Policy>
+class LinearMap
+{
+public:
+    bool transposes() const { return m_transpose; }
+    // Every append links at most one run of its own on top of the shared ones
+    std::size_t heapBytes() const { return m_scalars ? sizeof(ScalarRun) : 0; }
+    // Scratch that tryApply() takes for walking the floating point scalars
+    std::size_t scratchBytes() const
+    {
+        return m_scalars ? Scratch::bytesFor<const ScalarRun*>(m_scalars->depth + 1) : 0;
+    }
+
+    void appendTranspose() { m_transpose = !m_transpose; }
+
+    void appendScale(Value scalar)
+    {
+        auto stage = LinearMap();
+        if constexpr (std::is_integral_v<Value>)
+        {
+            stage.m_scale = scalar;
+            if constexpr (Policy::checked)
+            {
+                stage.m_prefix = static_cast<long long>(scalar);
+                if (scalar != 0)
+                {
+                    // The stage accepts exactly the inputs whose product stays in range
+                    const auto s = static_cast<long long>(scalar);
+                    stage.m_lowest = s > 0 ? detail::ceilDiv(Policy::lowest, s) : detail::ceilDiv(Policy::highest, s);
+                    stage.m_highest = s > 0 ? detail::floorDiv(Policy::highest, s) : detail::floorDiv(Policy::lowest, s);
+                }
+            }
+        }
+        else
+            stage.m_scalars = std::make_shared<const ScalarRun>(ScalarRun{ nullptr, nullptr, scalar, 1 });
+        append(stage);
+    }
+
+    // This map followed by next
+    void append(const LinearMap& next)
+    {
+        m_transpose = m_transpose != next.m_transpose;
+        if constexpr (std::is_integral_v<Value>)
+        {
+            m_scale = static_cast<Value>(static_cast<Wrapping>(m_scale) * static_cast<Wrapping>(next.m_scale));
+            if constexpr (Policy::checked)
+            {
+                // next sees prefix * x, so its interval divided by the prefix restricts x
+                const auto p = m_prefix;
+                if (p == 0)
+                {
+                    if (next.m_lowest > 0 || next.m_highest < 0)
+                        m_highest = m_lowest - 1;
+                }
+                else
+                {
+                    m_lowest = std::max(m_lowest, p > 0 ? ceilDiv(next.m_lowest, p) : ceilDiv(next.m_highest, p));
+                    m_highest = std::min(m_highest, p > 0 ? floorDiv(next.m_highest, p) : floorDiv(next.m_lowest, p));
+                }
+                m_prefix = saturatingMultiply(m_prefix, next.m_prefix);
+            }
+        }
+        else if (!m_scalars || !next.m_scalars)
+            m_scalars = m_scalars ? m_scalars : next.m_scalars;
+        else
+        {
+            const auto depth = std::max(m_scalars->depth, next.m_scalars->depth) + 1;
+            m_scalars = std::make_shared<const ScalarRun>(ScalarRun{ m_scalars, next.m_scalars, Value(), depth });
+        }
+    }
+
+    // Writes the image of the size * size elements of input (stored row after row) to
+    // output; throws std::out_of_range where the chain would
+    void apply(const Value* input, Value* output, int size) const
+    {
+        auto scratch = Scratch(scratchBytes());
+        if (tryApply(input, output, size, scratch))
+            throw std::out_of_range("Matrix value is out of range");
+    }
+
+    // apply() that reports where the chain fails instead of throwing: the position in
+    // the output and, for integral elements, the input element no stage sequence accepts.
+    // scratch must have scratchBytes() free
+    std::optional<detail::RangeFault> tryApply(const Value* input, Value* output, int size, Scratch& scratch) const
+    {
+        const auto count = static_cast<std::size_t>(size) * static_cast<std::size_t>(size);
+        if constexpr (std::is_integral_v<Value> && Policy::checked)
+        {
+            if (count != 0)
+            {
+                const auto [minValue, maxValue] = detail::minMax(input, count);
+                if (static_cast<long long>(minValue) < m_lowest || static_cast<long long>(maxValue) > m_highest)
+                {
+                    const auto k = static_cast<std::size_t>(std::find_if(input, input + count, [this](Value value)
+                        { return static_cast<long long>(value) < m_lowest || static_cast<long long>(value) > m_highest; }) - input);
+                    const auto n = static_cast<std::size_t>(size);
+                    return detail::RangeFault{ m_transpose ? k % n * n + k / n : k, static_cast<double>(input[k]) };
+                }
+            }
+        }
+
+        if (m_transpose)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                for (int j = 0; j < size; ++j)
+                    output[static_cast<std::size_t>(i) * static_cast<std::size_t>(size) + static_cast<std::size_t>(j)]
+                        = input[static_cast<std::size_t>(j) * static_cast<std::size_t>(size) + static_cast<std::size_t>(i)];
+            }
+        }
+        else
+            std::copy_n(input, count, output);
+
+        if constexpr (std::is_integral_v<Value>)
+        {
+            if (m_scale != 1)
+            {
+                for (std::size_t k = 0; k < count; ++k)
+                    output[k] = static_cast<Value>(static_cast<Wrapping>(output[k]) * static_cast<Wrapping>(m_scale));
+            }
+        }
+        else if (m_scalars)
+        {
+            // In-order walk of the runs; a pending back half per level at most
+            const auto mark = ScratchMark(scratch);
+            auto** pending = scratch.allocate<const ScalarRun*>(m_scalars->depth + 1);
+            std::size_t top = 0;
+            pending[top++] = m_scalars.get();
+            while (top != 0)
+            {
+                const auto* run = pending[--top];
+                if (run->front)
+                {
+                    pending[top++] = run->back.get();
+                    pending[top++] = run->front.get();
+                }
+                else if (auto fault = detail::tryScaleValues<Value, Policy>(output, count, run->scalar))
+                    return fault;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    // A single scalar, or the scalars of front followed by those of back
+    struct ScalarRun
+    {
+        std::shared_ptr<const ScalarRun> front;
+        std::shared_ptr<const ScalarRun> back;
+        Value scalar;
+        std::size_t depth;
+    };
+
+    // Same wrapping arithmetic as the unchecked stages
+    using Wrapping = detail::Wrapping<Value>;
+
+    // Far beyond any range, and still far from overflowing when divided by
+    static constexpr long long saturation = 1LL << 62;
+
+    static long long saturatingMultiply(long long a, long long b)
+    {
+        long long product = 0;
+        if (__builtin_mul_overflow(a, b, &product) || product > saturation || product < -saturation)
+            return (a < 0) != (b < 0) ? -saturation : saturation;
+        return product;
+    }
+
+    // Division rounding that keeps the unbounded ends of an interval unbounded
+    static long long ceilDiv(long long a, long long b)
+    {
+        if (a == unbounded || a == -unbounded)
+            return (a < 0) == (b < 0) ? unbounded : -unbounded;
+        return detail::ceilDiv(a, b);
+    }
+
+    static long long floorDiv(long long a, long long b)
+    {
+        if (a == unbounded || a == -unbounded)
+            return (a < 0) == (b < 0) ? unbounded : -unbounded;
+        return detail::floorDiv(a, b);
+    }
+
+    static constexpr long long unbounded = std::numeric_limits<long long>::max();
+
+    bool m_transpose = false;
+    Value m_scale = 1;
+    std::shared_ptr<const ScalarRun> m_scalars;     // floating point: the scalars in order
+    long long m_prefix = 1;             // checked integral: the product, saturated
+    long long m_lowest = -unbounded;    // checked integral: the inputs every stage accepts
+    long long m_highest = unbounded;
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+// Read-only view of a whole file. On POSIX systems the file is memory-mapped, so opening
+// it costs no copy and pages are only read when touched; elsewhere it is read into memory.
+class MappedFile
+{
+public:
+    // Throws std::invalid_argument when the file cannot be opened
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::byte* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    const std::byte* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_mapped = false;
+    std::vector<std::byte> m_buffer;    // used when the file could not be mapped
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "SquareMatrix.h"
+
+#include <cstddef>
+#include <type_traits>
+
+
+// Non-owning view of the size * size elements of a square matrix stored row after row,
+// in a SquareMatrix or in any other buffer (for example scratch memory).
+// MatrixRef<const T> is the read-only view used for inputs.
+template <typename T>
+class MatrixRef
+{
+public:
+    using value_type = std::remove_const_t<T>;
+
+    MatrixRef(T* data, int size)
+        : m_data(data), m_size(size)
+    {
+    }
+
+    template <typename Policy>
+    MatrixRef(SquareMatrix<value_type, Policy>& matrix)
+        : MatrixRef(matrix.data(), matrix.size())
+    {
+    }
+
+    template <typename Policy>
+        requires std::is_const_v<T>
+    MatrixRef(const SquareMatrix<value_type, Policy>& matrix)
+        : MatrixRef(matrix.data(), matrix.size())
+    {
+    }
+
+    // A writable view can always be read
+    template <typename U>
+        requires (std::is_const_v<T> && std::is_same_v<U, value_type>)
+    MatrixRef(const MatrixRef<U>& other)
+        : MatrixRef(other.data(), other.size())
+    {
+    }
+
+    T* data() const { return m_data; }
+    int size() const { return m_size; }
+    std::size_t count() const { return static_cast<std::size_t>(m_size) * static_cast<std::size_t>(m_size); }
+
+    T& operator()(int i, int j) const
+    {
+        return m_data[static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(j)];
+    }
+
+private:
+    T* m_data;
+    int m_size;
+};
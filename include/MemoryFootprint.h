@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+
+// Static memory of operation trees: the operation objects and the shared_ptr control
+// blocks that own them. A node shared by several parents (or by several operations of
+// the list) is counted once per accounting.
+class MemoryFootprint
+{
+public:
+    // make_shared keeps the object and its control block (vtable pointer and the two
+    // reference counts) in one allocation; the standard does not give its size
+    static constexpr std::size_t controlBlockBytes = sizeof(void*) + 2 * sizeof(int);
+
+    // Adds the nodes of root that were not counted yet
+    void add(const OperationBase& root);
+
+    std::size_t nodes() const { return m_seen.size(); }
+    std::size_t bytes() const { return m_bytes; }
+
+    // Footprint of one operation on its own
+    static MemoryFootprint of(const OperationBase& root);
+
+    // Upper bound of the memory an evaluation of operation on size x size matrices holds
+    // at once through computeInto: the inputs, the result, their views and the scratch
+    static std::size_t evalBytes(const Operation& operation, int size);
+
+    // Throws std::length_error when evaluations running at once (each holding evalBytes)
+    // would need more than limit bytes; 0 is no limit
+    static void checkEvalLimit(const Operation& operation, int size, std::size_t limit, int evaluations = 1);
+
+private:
+    std::unordered_set<const OperationBase*> m_seen;
+    std::size_t m_bytes = 0;
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+
+// Live and peak bytes of matrix storage, counted by TrackingAllocator.
+// The counters are process wide and relaxed: they are for reporting and for checking
+// budgets, not for synchronizing anything.
+class MemoryTracker
+{
+public:
+    static std::size_t live() { return s_live.load(std::memory_order_relaxed); }
+    static std::size_t peak() { return s_peak.load(std::memory_order_relaxed); }
+
+    // Starts a new peak from the current live bytes
+    static void resetPeak() { s_peak.store(live(), std::memory_order_relaxed); }
+
+    static void allocated(std::size_t bytes)
+    {
+        const auto now = s_live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = s_peak.load(std::memory_order_relaxed);
+        while (now > peak && !s_peak.compare_exchange_weak(peak, now, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    static void released(std::size_t bytes) { s_live.fetch_sub(bytes, std::memory_order_relaxed); }
+
+private:
+    inline static std::atomic<std::size_t> s_live = 0;
+    inline static std::atomic<std::size_t> s_peak = 0;
+};
+
+
+// std::allocator that reports every allocation to MemoryTracker
+template <typename T>
+class TrackingAllocator
+{
+public:
+    using value_type = T;
+
+    TrackingAllocator() = default;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U>&) noexcept
+    {
+    }
+
+    T* allocate(std::size_t count)
+    {
+        auto* result = std::allocator<T>().allocate(count);
+        MemoryTracker::allocated(count * sizeof(T));
+        return result;
+    }
+
+    void deallocate(T* values, std::size_t count) noexcept
+    {
+        MemoryTracker::released(count * sizeof(T));
+        std::allocator<T>().deallocate(values, count);
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U>&) const noexcept { return true; }
+};
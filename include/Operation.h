@@ -1,26 +1,122 @@
 #pragma once
 
 #include "SquareMatrix.h"
+#include "StructuredMatrix.h"
+#include "MatrixRef.h"
+#include "Scratch.h"
 
 #include <vector>
+#include <span>
+#include <expected>
+#include <optional>
 #include <iosfwd>
+#include <cstdint>
 
 
-// Represents an operation on sets
-class Operation
+// The part of an operation that does not depend on the element type:
+// its shape, how it prints and what it is built from
+class OperationBase
 {
 public:
-    using T = SquareMatrix<int>;
-    virtual ~Operation() = default;
+    enum class Kind { Identity, Transpose, Scalar, Add, Sub, Comp };
+
+    virtual ~OperationBase() = default;
+
+    virtual Kind kind() const = 0;
 
     // Return the number of inputs (the range size) expected by compute()
     virtual int inputCount() const = 0;
 
+    // Prints the operation with generic name for the sets or with the actual input arguments
+    virtual void print(std::ostream& ostr, bool first_print = false) const = 0;
+
+    // The operations this one is built from, in print order
+    virtual std::vector<const OperationBase*> children() const { return {}; }
+
+    // Whether compute runs a folded form instead of calling the children (see LinearMap)
+    virtual bool foldsChildren() const { return false; }
+
+    // Memory of this node alone: the object and whatever it owns besides its children
+    virtual std::size_t objectBytes() const = 0;
+};
+
+
+// Why a non-throwing evaluation failed: the operation whose result first left the
+// range, the element of that result and the value it would have held.
+// A folded chain of scal/tran/id stages (see LinearMap) reports itself as the node and
+// the input element that one of its stages cannot take
+struct EvalFault
+{
+    struct Element
+    {
+        int row = 0;
+        int col = 0;
+        double value = 0;
+    };
+
+    const OperationBase* node = nullptr;
+    std::optional<Element> element;     // empty when the node only knows that it failed
+};
+
+inline EvalFault makeFault(const OperationBase& node, int size, const detail::RangeFault& fault)
+{
+    return { &node, EvalFault::Element{ static_cast<int>(fault.index / static_cast<std::size_t>(size)),
+                                        static_cast<int>(fault.index % static_cast<std::size_t>(size)), fault.value } };
+}
+
+
+// Represents an operation on matrices of type M (a SquareMatrix of some element type and range policy)
+template <typename M>
+class BasicOperation : public OperationBase
+{
+public:
+    using T = M;
+    using S = StructuredMatrix<typename M::value_type, typename M::policy_type>;
+    using Ref = MatrixRef<typename M::value_type>;
+    using ConstRef = MatrixRef<const typename M::value_type>;
+    using OperationBase::print;
+
     // Computes the resulted set
     virtual T compute(const std::vector<T>& input) const =0;
 
-    // Prints the operation with generic name for the sets or with the actual input arguments
-    virtual void print(std::ostream& ostr, bool first_print = false) const = 0;
+    // Computes on structured inputs, keeping their structure where the operation allows it.
+    // The default converts the inputs to dense matrices and calls compute()
+    virtual S computeStructured(const std::vector<S>& input) const;
+
+    // Computes into out, which must not overlap the inputs, taking every temporary from
+    // scratch: once scratch holds scratchBytes(out.size()) nothing is allocated.
+    // Range errors come back as the fault instead of an exception (out then holds
+    // partial results). The default calls compute() on copies of the inputs and, as
+    // compute() does not say where it failed, reports the fault without an element
+    virtual std::optional<EvalFault> tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const;
+
+    // tryComputeInto() that throws std::out_of_range on a fault
+    void computeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const;
+
+    // compute() without exceptions for range errors, through tryComputeInto()
+    std::expected<T, EvalFault> tryCompute(const std::vector<T>& input) const;
+
+    // Scratch memory computeInto() needs for matrices of the given size
+    virtual std::size_t scratchBytes(int size) const { (void)size; return 0; }
 
     virtual void print(std::ostream& ostr, const std::vector<T>& input) const;
 };
+
+
+// The calculator works on int matrices in the range [-1024, 1000]
+using Operation = BasicOperation<SquareMatrix<int>>;
+
+
+// Explicitly instantiates an operation class template for every supported matrix type,
+// used at the end of the .cpp file that defines the members
+#define INSTANTIATE_FOR_MATRIX_TYPES(Class) \
+    template class Class<SquareMatrix<std::int16_t>>; \
+    template class Class<SquareMatrix<std::int32_t>>; \
+    template class Class<SquareMatrix<std::int64_t>>; \
+    template class Class<SquareMatrix<float>>; \
+    template class Class<SquareMatrix<double>>; \
+    template class Class<SquareMatrix<std::int16_t, Unchecked>>; \
+    template class Class<SquareMatrix<std::int32_t, Unchecked>>; \
+    template class Class<SquareMatrix<std::int64_t, Unchecked>>; \
+    template class Class<SquareMatrix<float, Unchecked>>; \
+    template class Class<SquareMatrix<double, Unchecked>>
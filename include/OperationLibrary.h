@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Saves an operation list to a compact binary snapshot and loads it back.
+//
+// The file holds a header, a table of fixed size node records and the list of root
+// nodes (the operation list, in order). Every node is stored once: subtrees shared by
+// pointer, and equal subtrees built separately, point to the same record. Records are
+// written children first, so loading is a single pass over the memory-mapped table.
+// Each record also keeps the input count of its node, which the loader checks against
+// the rebuilt tree to reject damaged files.
+// The records use the byte order of the machine that wrote them.
+class OperationLibrary
+{
+public:
+    using OperationList = std::vector<std::shared_ptr<Operation>>;
+
+    static void save(const std::string& path, const OperationList& operations);
+
+    // Throws std::invalid_argument when the file is missing or is not a valid snapshot
+    static OperationList load(const std::string& path);
+
+private:
+    static constexpr char fileMagic[8] = { 'O', 'O', 'P', '2', 'L', 'I', 'B', '\0' };
+    static constexpr std::uint32_t fileVersion = 1;
+
+    struct Header
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t nodeCount;
+        std::uint32_t rootCount;
+        std::uint32_t reserved;
+    };
+
+    struct NodeRecord
+    {
+        std::uint8_t kind;
+        std::uint8_t reserved[3];
+        std::int32_t inputCount;
+        std::uint32_t first;    // index of an earlier record, unused for unary kinds
+        std::uint32_t second;
+        std::int64_t scalar;
+    };
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+// Operation list shared between threads that evaluate and threads that edit it.
+// Readers take an immutable snapshot with one atomic load and keep using it for as
+// long as they like. Writers copy the current list, change the copy and publish it
+// as the next version, one writer at a time, so a reader never waits for a copy or a
+// change. std::atomic<std::shared_ptr> is not lock-free in libstdc++ though: a load
+// can spin for as long as a concurrent store takes to swap the pointer.
+// The version number is published together with its list, so both always match.
+// Retired lists and operations are freed by reference counting once the last
+// snapshot that still holds them is dropped.
+class OperationRegistry
+{
+public:
+    using OperationList = std::vector<std::shared_ptr<Operation>>;
+    using Snapshot = std::shared_ptr<const OperationList>;
+
+    explicit OperationRegistry(OperationList operations = {});
+
+    Snapshot snapshot() const;
+    std::size_t size() const { return snapshot()->size(); }
+
+    // Number of versions published so far, 0 for the initial list
+    std::uint64_t version() const { return m_current.load(std::memory_order_acquire)->version; }
+
+    // Throws std::out_of_range when index is not in the current list
+    std::shared_ptr<Operation> at(std::size_t index) const;
+
+    // Returns the index of the new operation
+    std::size_t add(std::shared_ptr<Operation> operation);
+    void erase(std::size_t index);
+    void truncate(std::size_t size);
+    void assign(OperationList operations);
+
+private:
+    // One published version; snapshots point into it and keep it alive
+    struct State
+    {
+        OperationList operations;
+        std::uint64_t version = 0;
+    };
+
+    template <typename Change>
+    void update(Change change);
+
+    std::atomic<std::shared_ptr<const State>> m_current;
+    std::mutex m_writeMutex;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class OperationBase;
+
+
+// Collects per-node statistics of Operation::compute calls.
+// The hooks are only compiled in when OOP2_PROFILING is defined (cmake -DOOP2_PROFILING=ON),
+// otherwise PROFILE_OPERATION (and PROFILE_MATRIX_CREATED in SquareMatrix.h) expand to nothing.
+class Profiler
+{
+public:
+    struct NodeStats
+    {
+        std::string label;
+        std::int64_t calls = 0;
+        std::int64_t wallNs = 0;            // inclusive of the children
+        std::int64_t bytesAllocated = 0;    // matrices created by the node itself
+        std::int64_t matricesCreated = 0;
+    };
+
+    // Measures one compute call of a node for as long as it lives
+    class Scope
+    {
+    public:
+        explicit Scope(const OperationBase& operation);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const OperationBase* m_operation;
+        std::int64_t m_startNs;
+    };
+
+    static Profiler& instance();
+    static constexpr bool compiledIn()
+    {
+#ifdef OOP2_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Clears the previous results and starts recording
+    void start();
+    void stop();
+    bool active() const { return m_active; }
+
+    const NodeStats* stats(const OperationBase& operation) const;
+
+    // Prints the tree rooted at operation, one node per line with its statistics
+    void printTree(std::ostream& ostr, const OperationBase& root) const;
+
+    // Writes the recorded calls in the Chrome trace event format (chrome://tracing, Perfetto)
+    void writeChromeTrace(std::ostream& ostr) const;
+
+    void matrixCreated(std::size_t bytes);
+
+private:
+    struct TraceEvent
+    {
+        const OperationBase* operation;
+        std::int64_t startNs;
+        std::int64_t durationNs;
+        std::size_t thread;
+    };
+
+    void record(const OperationBase& operation, std::int64_t startNs, std::int64_t endNs);
+    // folded: an ancestor ran a folded form, so the node had no calls of its own
+    void printNode(std::ostream& ostr, const OperationBase& operation, int depth, bool folded) const;
+
+    std::atomic<bool> m_active = false;
+    std::int64_t m_originNs = 0;
+    mutable std::mutex m_mutex;
+    std::unordered_map<const OperationBase*, NodeStats> m_stats;
+    std::vector<TraceEvent> m_events;
+};
+
+
+#ifdef OOP2_PROFILING
+#define PROFILE_OPERATION(operation) const Profiler::Scope profileScope_((operation))
+#else
+#define PROFILE_OPERATION(operation) ((void)0)
+#endif
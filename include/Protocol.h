@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+
+// Wire format shared by the calculator server and its client.
+// Every request and response is a frame: a 4 byte payload length in host byte order
+// (both ends run on the same machine) followed by the payload text.
+// A request payload is one command, for example "eval 2 2  1 2 3 4" - the tokens are
+// whitespace separated, so a whole request fits on one line.
+// A response payload starts with "ok\n" or "error\n" followed by the result or message.
+namespace protocol
+{
+    constexpr std::size_t headerSize = sizeof(std::uint32_t);
+    constexpr std::uint32_t maxPayload = 1u << 20;
+
+    inline std::string frame(std::string_view payload)
+    {
+        const auto length = static_cast<std::uint32_t>(payload.size());
+        auto result = std::string(headerSize, '\0');
+        std::memcpy(result.data(), &length, headerSize);
+        result.append(payload);
+        return result;
+    }
+
+    // Payload length of the frame starting at data, empty while the header is incomplete
+    inline std::optional<std::uint32_t> payloadLength(const char* data, std::size_t available)
+    {
+        if (available < headerSize)
+            return std::nullopt;
+        auto length = std::uint32_t{};
+        std::memcpy(&length, data, headerSize);
+        return length;
+    }
+}
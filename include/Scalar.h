@@ -3,16 +3,29 @@
 #include "UnaryOperation.h"
 
 
-// Represents the identity operation
-// Returns the same set that it gets as input
-// Used as the leaf in every operation tree
-class Scalar : public UnaryOperation
+// Represents the scalar multiplication operation
+// Returns the input matrix with every element multiplied by the scalar
+template <typename M>
+class BasicScalar : public BasicUnaryOperation<M>
 {
 public:
-    Scalar(int scalar);
+    using T = typename BasicOperation<M>::T;
+    using S = typename BasicOperation<M>::S;
+    using Ref = typename BasicOperation<M>::Ref;
+    using ConstRef = typename BasicOperation<M>::ConstRef;
+    using Value = typename M::value_type;
+
+    BasicScalar(Value scalar);
+    OperationBase::Kind kind() const override { return OperationBase::Kind::Scalar; }
+    std::size_t objectBytes() const override { return sizeof(*this); }
+    Value scalar() const { return m_scalar; }
     T compute(const std::vector<T>& input) const override;
+    S computeStructured(const std::vector<S>& input) const override;
+    std::optional<EvalFault> tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 private:
-    int m_scalar;
+    Value m_scalar;
 };
+
+using Scalar = BasicScalar<Operation::T>;
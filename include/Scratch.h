@@ -0,0 +1,91 @@
+#pragma once
+
+#include "MemoryTracker.h"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+
+// Bump allocator for the temporaries of Operation::computeInto.
+// allocate() hands out the next piece of one preallocated block and release() returns
+// everything allocated after a mark() at once, so a computation that nests like the
+// operation tree reuses the same memory and never calls the system allocator.
+// The block never moves: asking for more than the capacity throws std::length_error.
+class Scratch
+{
+public:
+    // Every allocation starts at this alignment, which suits any element type
+    static constexpr std::size_t alignment = alignof(std::max_align_t);
+
+    explicit Scratch(std::size_t bytes = 0);
+
+    // Makes room for at least bytes; reallocates (and so must not be called while
+    // allocations are in use) only when the current block is smaller
+    void reserve(std::size_t bytes);
+
+    std::size_t capacity() const { return m_capacity; }
+    std::size_t used() const { return m_used; }
+    std::size_t peak() const { return m_peak; }
+
+    std::size_t mark() const { return m_used; }
+    void release(std::size_t mark) { m_used = mark; }
+
+    // Bytes that allocate<T>(count) takes from the block, for computing requirements up front
+    template <typename T>
+    static constexpr std::size_t bytesFor(std::size_t count)
+    {
+        return (count * sizeof(T) + alignment - 1) / alignment * alignment;
+    }
+
+    // Uninitialized room for count objects of a trivially destructible T
+    template <typename T>
+    T* allocate(std::size_t count)
+    {
+        const auto bytes = bytesFor<T>(count);
+        if (bytes > m_capacity - m_used)
+            throw std::length_error("Scratch memory exhausted, reserve scratchBytes() first");
+        auto* result = reinterpret_cast<T*>(m_block.get() + m_used);
+        m_used += bytes;
+        m_peak = m_used > m_peak ? m_used : m_peak;
+        return result;
+    }
+
+private:
+    // Also gives the block back to MemoryTracker, which counts scratch like matrices
+    struct AlignedDelete
+    {
+        std::size_t bytes;
+
+        void operator()(std::byte* block) const
+        {
+            MemoryTracker::released(bytes);
+            ::operator delete[](block, std::align_val_t{ alignment });
+        }
+    };
+
+    std::unique_ptr<std::byte[], AlignedDelete> m_block;
+    std::size_t m_capacity = 0;
+    std::size_t m_used = 0;
+    std::size_t m_peak = 0;
+};
+
+
+// Restores the scratch position when it goes out of scope
+class ScratchMark
+{
+public:
+    explicit ScratchMark(Scratch& scratch)
+        : m_scratch(scratch), m_mark(scratch.mark())
+    {
+    }
+
+    ~ScratchMark() { m_scratch.release(m_mark); }
+    ScratchMark(const ScratchMark&) = delete;
+    ScratchMark& operator=(const ScratchMark&) = delete;
+
+private:
+    Scratch& m_scratch;
+    std::size_t m_mark;
+};
@@ -2,57 +2,321 @@
 
 #include <vector>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
 
+#include "MemoryTracker.h"
 
-template <typename T>
+
+// Profiler hook for matrix storage; only the declaration lives here so matrices don't
+// pull the profiler into every translation unit (defined in Profiler.cpp)
+#ifdef OOP2_PROFILING
+void profileMatrixCreated(std::size_t bytes);
+#define PROFILE_MATRIX_CREATED(bytes) profileMatrixCreated((bytes))
+#else
+#define PROFILE_MATRIX_CREATED(bytes) ((void)0)
+#endif
+
+
+// Range policies decide which values a matrix may hold.
+// A checked policy throws std::out_of_range when a result leaves [lowest, highest],
+// Unchecked compiles the checks (and their branches) out and lets the arithmetic wrap.
+template <long long Lowest, long long Highest>
+struct BoundedRange
+{
+	static constexpr bool checked = true;
+	static constexpr long long lowest = Lowest;
+	static constexpr long long highest = Highest;
+};
+
+// The calculator accepts values between -1024 and 1000
+using CalculatorRange = BoundedRange<-1024, 1000>;
+
+struct Unchecked
+{
+	static constexpr bool checked = false;
+};
+
+
+namespace detail
+{
+	// Type the checked kernels compute in, wide enough that the result is checked before it can overflow
+	template <typename T> struct Wide { using type = T; };
+	template <> struct Wide<std::int16_t> { using type = std::int32_t; };
+	template <> struct Wide<std::int32_t> { using type = std::int64_t; };
+
+	// Type the unchecked kernels compute in: integral values go through the unsigned type of
+	// their promoted product, so the arithmetic really wraps instead of overflowing a signed value
+	template <typename T>
+	using Wrapping = typename std::conditional_t<std::is_integral_v<T>,
+		std::make_unsigned<decltype(T() * T())>, std::type_identity<T>>::type;
+
+	inline long long floorDiv(long long a, long long b)
+	{
+		const long long q = a / b;
+		return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+	}
+
+	inline long long ceilDiv(long long a, long long b)
+	{
+		const long long q = a / b;
+		return (a % b != 0 && ((a < 0) == (b < 0))) ? q + 1 : q;
+	}
+
+	// Branch free min/max reduction that the compiler can vectorize, unlike std::minmax_element
+	template <typename T>
+	std::pair<T, T> minMax(const T* values, std::size_t count)
+	{
+		auto low = std::numeric_limits<T>::max();
+		auto high = std::numeric_limits<T>::lowest();
+		for (std::size_t k = 0; k < count; ++k)
+		{
+			low = std::min(low, values[k]);
+			high = std::max(high, values[k]);
+		}
+		return { low, high };
+	}
+
+	template <typename T>
+	std::pair<T, T> minMax(const std::vector<T>& values)
+	{
+		return minMax(values.data(), values.size());
+	}
+
+	// Where a checked kernel first left the range: the element and the value it would
+	// have held
+	struct RangeFault
+	{
+		std::size_t index;
+		double value;
+	};
+
+	// Element-wise kernels shared by the matrix representations, they work on the stored
+	// values only: an implicit zero can never take a result out of range.
+	// The try versions report the first element that left the range instead of throwing,
+	// leaving the destination partly updated. They work through blocks small enough for
+	// the stack: one loop writes a block and keeps its wide values and a running min/max
+	// without branching per element (the flag that the block left the range), and only
+	// a flagged block is searched for its first fault.
+	// The throwing versions wrap them.
+
+	template <typename T, typename Wider, typename Combine>
+	std::optional<RangeFault> tryCombineValues(T* lhs, const T* rhs, std::size_t count, Wider lowest, Wider highest, Combine combine)
+	{
+		constexpr std::size_t block = 256;
+		Wider values[block];
+		for (std::size_t start = 0; start < count; start += block)
+		{
+			const auto n = std::min(block, count - start);
+			auto high = std::numeric_limits<Wider>::lowest();
+			auto low = std::numeric_limits<Wider>::max();
+			for (std::size_t k = 0; k < n; ++k)
+			{
+				const auto value = combine(static_cast<Wider>(lhs[start + k]), static_cast<Wider>(rhs[start + k]));
+				high = std::max(high, value);
+				low = std::min(low, value);
+				values[k] = value;
+				lhs[start + k] = static_cast<T>(value);
+			}
+			if (low < lowest || high > highest)
+			{
+				const auto k = static_cast<std::size_t>(std::find_if(values, values + n,
+					[&](Wider value) { return value < lowest || value > highest; }) - values);
+				return RangeFault{ start + k, static_cast<double>(values[k]) };
+			}
+		}
+		return std::nullopt;
+	}
+
+	// lhs[k] += rhs[k]
+	template <typename T, typename Policy>
+	std::optional<RangeFault> tryAddValues(T* lhs, const T* rhs, std::size_t count)
+	{
+		using Wider = typename Wide<T>::type;
+		if constexpr (!Policy::checked)
+		{
+			for (std::size_t k = 0; k < count; ++k)
+			{
+				lhs[k] = static_cast<T>(static_cast<Wrapping<T>>(lhs[k]) + static_cast<Wrapping<T>>(rhs[k]));
+			}
+			return std::nullopt;
+		}
+		else
+		{
+			//chack if not bigger than 1000, and that nothing overflowed the element type
+			return tryCombineValues(lhs, rhs, count, static_cast<Wider>(std::numeric_limits<T>::lowest()), static_cast<Wider>(Policy::highest),
+				[](Wider a, Wider b) { return static_cast<Wider>(a + b); });
+		}
+	}
+
+	// lhs[k] -= rhs[k]
+	template <typename T, typename Policy>
+	std::optional<RangeFault> trySubValues(T* lhs, const T* rhs, std::size_t count)
+	{
+		using Wider = typename Wide<T>::type;
+		if constexpr (!Policy::checked)
+		{
+			for (std::size_t k = 0; k < count; ++k)
+			{
+				lhs[k] = static_cast<T>(static_cast<Wrapping<T>>(lhs[k]) - static_cast<Wrapping<T>>(rhs[k]));
+			}
+			return std::nullopt;
+		}
+		else
+		{
+			//chack if not small than -1024, and that nothing overflowed the element type
+			return tryCombineValues(lhs, rhs, count, static_cast<Wider>(Policy::lowest), static_cast<Wider>(std::numeric_limits<T>::max()),
+				[](Wider a, Wider b) { return static_cast<Wider>(a - b); });
+		}
+	}
+
+	// values[k] *= scalar
+	template <typename T, typename Policy>
+	std::optional<RangeFault> tryScaleValues(T* values, std::size_t count, T scalar)
+	{
+		if constexpr (Policy::checked && std::is_integral_v<T>)
+		{
+			// x * scalar is in range exactly when x is within the bounds divided by scalar,
+			// so the inputs are checked up front and the products can never overflow
+			if (scalar != 0 && count != 0)
+			{
+				const auto s = static_cast<long long>(scalar);
+				const auto low = s > 0 ? ceilDiv(Policy::lowest, s) : ceilDiv(Policy::highest, s);
+				const auto high = s > 0 ? floorDiv(Policy::highest, s) : floorDiv(Policy::lowest, s);
+				const auto [minValue, maxValue] = minMax(values, count);
+				//chack if not small than -1024 or bigger than 1000
+				if (static_cast<long long>(minValue) < low || static_cast<long long>(maxValue) > high)
+				{
+					const auto k = static_cast<std::size_t>(std::find_if(values, values + count,
+						[&](T value) { return value < low || value > high; }) - values);
+					return RangeFault{ k, static_cast<double>(values[k]) * static_cast<double>(scalar) };
+				}
+			}
+		}
+
+		// Checked integral inputs were validated above, so wrapping only ever applies to Unchecked
+		for (std::size_t k = 0; k < count; ++k)
+		{
+			values[k] = static_cast<T>(static_cast<Wrapping<T>>(values[k]) * static_cast<Wrapping<T>>(scalar));
+		}
+
+		if constexpr (Policy::checked && !std::is_integral_v<T>)
+		{
+			if (count != 0)
+			{
+				const auto [minValue, maxValue] = minMax(values, count);
+				if (maxValue > static_cast<T>(Policy::highest) || minValue < static_cast<T>(Policy::lowest))
+				{
+					const auto k = static_cast<std::size_t>(std::find_if(values, values + count, [](T value)
+						{ return value > static_cast<T>(Policy::highest) || value < static_cast<T>(Policy::lowest); }) - values);
+					return RangeFault{ k, static_cast<double>(values[k]) };
+				}
+			}
+		}
+		return std::nullopt;
+	}
+
+	template <typename T, typename Policy>
+	void addValues(T* lhs, const T* rhs, std::size_t count)
+	{
+		if (tryAddValues<T, Policy>(lhs, rhs, count))
+		{
+			throw std::out_of_range("Matrix value is out of range");
+		}
+	}
+
+	template <typename T, typename Policy>
+	void subValues(T* lhs, const T* rhs, std::size_t count)
+	{
+		if (trySubValues<T, Policy>(lhs, rhs, count))
+		{
+			throw std::out_of_range("Matrix value is out of range");
+		}
+	}
+
+	template <typename T, typename Policy>
+	void scaleValues(T* values, std::size_t count, T scalar)
+	{
+		if (tryScaleValues<T, Policy>(values, count, scalar))
+		{
+			throw std::out_of_range("Matrix value is out of range");
+		}
+	}
+}
+
+
+// Square matrix of T stored row after row in one contiguous buffer, so the element
+// loops vectorize and narrow types pack more elements per SIMD register
+template <typename T, typename Policy = CalculatorRange>
 class SquareMatrix
 {
 public:
+	using value_type = T;
+	using policy_type = Policy;
+
+#ifdef OOP2_PROFILING
+	SquareMatrix(const SquareMatrix& other)
+		: m_size(other.m_size), m_data(other.m_data)
+	{
+		PROFILE_MATRIX_CREATED(storageBytes());
+	}
+#else
 	SquareMatrix(const SquareMatrix&) = default;
+#endif
 	SquareMatrix(SquareMatrix&&) = default;
 	SquareMatrix& operator=(const SquareMatrix&) = default;
 	SquareMatrix& operator=(SquareMatrix&&) = default;
 	~SquareMatrix() = default;
-	//SquareMatrix(const std::vector<std::vector<T>>& matrix);
-	//SquareMatrix(std::vector<std::vector<T>>&& matrix);
 	SquareMatrix(int size, const T& value);
 	SquareMatrix(int size);
 	int size() const
 	{
 		return m_size;
 	};
+	// Bytes of heap storage held by the matrix
+	std::size_t storageBytes() const
+	{
+		return m_data.size() * sizeof(T);
+	}
+	T* data() { return m_data.data(); }
+	const T* data() const { return m_data.data(); }
 	T& operator()(int i, int j);
 	const T& operator()(int i, int j) const;
 	SquareMatrix& operator+=(const SquareMatrix& rhs);
 	SquareMatrix& operator-=(const SquareMatrix& rhs);
-	//SquareMatrix& operator*=(const SquareMatrix& rhs);
-	//SquareMatrix& operator*=(const T& scalar);
 	SquareMatrix operator+(const SquareMatrix& rhs) const;
 	SquareMatrix operator-(const SquareMatrix& rhs) const;
-	//SquareMatrix operator*(const SquareMatrix& rhs) const;
 	SquareMatrix operator*(const T& scalar) const;
-	//bool operator==(const SquareMatrix& rhs) const;
-	//bool operator!=(const SquareMatrix& rhs) const;
 	SquareMatrix Transpose() const;
-	//void print(std::ostream& ostr) const;
+
+	// Throws std::out_of_range when value is outside the range of the policy
+	static void checkValue(T value);
+
 private:
 	int m_size;
-	std::vector<std::vector<T>> m_matrix;
+	std::vector<T, TrackingAllocator<T>> m_data;     // counted in MemoryTracker
 };
 
-template <typename T>
-const T& SquareMatrix<T>::operator()(int i, int j) const
+template <typename T, typename Policy>
+const T& SquareMatrix<T, Policy>::operator()(int i, int j) const
 {
-	return m_matrix[i][j];
+	return m_data[static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(j)];
 }
 
-template <typename T>
-T& SquareMatrix<T>::operator()(int i, int j)
+template <typename T, typename Policy>
+T& SquareMatrix<T, Policy>::operator()(int i, int j)
 {
-	return m_matrix[i][j];
+	return m_data[static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(j)];
 }
 
-inline std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<int>& matrix)
+template <typename T, typename Policy>
+std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<T, Policy>& matrix)
 {
 	for (int i = 0; i < matrix.size(); ++i)
 	{
@@ -65,11 +329,9 @@ inline std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<int>& mat
 	return ostr;
 }
 
-inline std::istream& operator>>(std::istream& in, SquareMatrix<int>& matrix)
+template <typename T, typename Policy>
+std::istream& operator>>(std::istream& in, SquareMatrix<T, Policy>& matrix)
 {
-	//istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-	//if there is more input then trow an exception
-	
 	for (int i = 0; i < matrix.size(); ++i)
 	{
 		for (int j = 0; j < matrix.size(); ++j)
@@ -79,14 +341,18 @@ inline std::istream& operator>>(std::istream& in, SquareMatrix<int>& matrix)
 			{
 				in.clear();
 				in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-				throw std::invalid_argument("Invalid input: expected an integer for matrix");
+				throw std::invalid_argument(std::is_integral_v<T> ? "Invalid input: expected an integer for matrix"
+				                                                  : "Invalid input: expected a number for matrix");
 			}
-			//chack if not bigger than 1000 or smaller than -1024
-			if (matrix(i, j) > 1000 || matrix(i, j) < -1024)
+			if constexpr (Policy::checked)
 			{
-				in.clear();
-				in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-				throw std::out_of_range("Matrix value is out of range");
+				//chack if not bigger than 1000 or smaller than -1024
+				if (matrix(i, j) > static_cast<T>(Policy::highest) || matrix(i, j) < static_cast<T>(Policy::lowest))
+				{
+					in.clear();
+					in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+					throw std::out_of_range("Matrix value is out of range");
+				}
 			}
 		}
 	}
@@ -95,105 +361,83 @@ inline std::istream& operator>>(std::istream& in, SquareMatrix<int>& matrix)
 
 // Implementation must be in .h file for the compiler to see it and instantiate
 // the relevant function
-template <typename T>
-SquareMatrix<T>::SquareMatrix(int size, const T& value)
-	: m_size(size), m_matrix(size, std::vector<T>(size, value))
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>::SquareMatrix(int size, const T& value)
+	: m_size(size), m_data(static_cast<std::size_t>(size) * static_cast<std::size_t>(size), value)
+{
+	PROFILE_MATRIX_CREATED(storageBytes());
+}
+
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>::SquareMatrix(int size)
+	: m_size(size), m_data(static_cast<std::size_t>(size) * static_cast<std::size_t>(size))
 {
-	for (int i = 0; i < size * size; ++i)
+	PROFILE_MATRIX_CREATED(storageBytes());
+	for (std::size_t k = 0; k < m_data.size(); ++k)
 	{
-		m_matrix[i / size][i % size] = value;
+		m_data[k] = static_cast<T>(k);
 	}
 }
 
-template <typename T>
-SquareMatrix<T>::SquareMatrix(int size)
-	: m_size(size), m_matrix(size, std::vector<T>(size))
+template <typename T, typename Policy>
+void SquareMatrix<T, Policy>::checkValue(T value)
 {
-	for (int i = 0; i < size * size; ++i)
+	if constexpr (Policy::checked)
 	{
-		m_matrix[i / size][i % size] = i;
+		if (value > static_cast<T>(Policy::highest) || value < static_cast<T>(Policy::lowest))
+		{
+			throw std::out_of_range("Matrix value is out of range");
+		}
 	}
 }
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator+(const SquareMatrix& rhs) const
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::operator+(const SquareMatrix& rhs) const
 {
 	SquareMatrix result(*this);
 	return result += rhs;
 }
 
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator-(const SquareMatrix& rhs) const
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::operator-(const SquareMatrix& rhs) const
 {
 	SquareMatrix result(*this);
 	return result -= rhs;
 }
 
-template <typename T>
-SquareMatrix<T>& SquareMatrix<T>::operator+=(const SquareMatrix& rhs)
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>& SquareMatrix<T, Policy>::operator+=(const SquareMatrix& rhs)
 {
-	for (int i = 0; i < m_size; ++i)
-	{
-		for (int j = 0; j < m_size; ++j)
-		{
-			m_matrix[i][j] += rhs.m_matrix[i][j];
-			//chack if not bigger than 1000
-			if (m_matrix[i][j] > 1000)
-			{
-				throw std::out_of_range("Matrix value is out of range");
-			}
-		}
-	}
+	detail::addValues<T, Policy>(m_data.data(), rhs.m_data.data(), m_data.size());
 	return *this;
 }
 
-template <typename T>
-SquareMatrix<T>& SquareMatrix<T>::operator-=(const SquareMatrix& rhs)
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>& SquareMatrix<T, Policy>::operator-=(const SquareMatrix& rhs)
 {
-	for (int i = 0; i < m_size; ++i)
-	{
-		for (int j = 0; j < m_size; ++j)
-		{
-			m_matrix[i][j] -= rhs.m_matrix[i][j];
-			//chack if not small than -1024
-			if (m_matrix[i][j] < -1024)
-			{
-				throw std::out_of_range("Matrix value is out of range");
-			}
-		}
-	}
+	detail::subValues<T, Policy>(m_data.data(), rhs.m_data.data(), m_data.size());
 	return *this;
 }
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::Transpose() const
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::Transpose() const
 {
-	SquareMatrix result(m_size);
+	SquareMatrix result(m_size, T{});
 	for (int i = 0; i < m_size; ++i)
 	{
 		for (int j = 0; j < m_size; ++j)
 		{
-			result(i, j) = m_matrix[j][i];
+			result(i, j) = (*this)(j, i);
 		}
 	}
 	return result;
 }
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator*(const T& scalar) const
+
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::operator*(const T& scalar) const
 {
 	SquareMatrix result(*this);
-	for (int i = 0; i < m_size; ++i)
-	{
-		for (int j = 0; j < m_size; ++j)
-		{
-			result(i, j) *= scalar;
-			//chack if not small than -1024 or bigger than 1000
-			if (result(i, j) < -1024 || result(i, j) > 1000)
-			{
-				throw std::out_of_range("Matrix value is out of range");
-			}
-		}
-	}
+	detail::scaleValues<T, Policy>(result.m_data.data(), result.m_data.size(), scalar);
 	return result;
-}
\ No newline at end of file
+}
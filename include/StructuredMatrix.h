@@ -0,0 +1,478 @@
+#pragma once
+
+#include "SquareMatrix.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+// Square matrix that stores only what its structure needs: the diagonal, one triangle
+// (for symmetric and triangular matrices) or the non-zero elements in CSR form.
+// Add, sub, scalar and transpose work on the stored values directly and keep the
+// structure, so a diagonal plus a diagonal is O(n); only mixing structures that have
+// no common compact form falls back to a dense result.
+// The range rules are those of SquareMatrix: the same kernels run over the stored values,
+// and an implicit zero can never take a result out of range.
+// The stored values are shared and never modified, so copies are cheap and the
+// transpose of a diagonal, symmetric or triangular matrix copies nothing.
+template <typename T, typename Policy = CalculatorRange>
+class StructuredMatrix
+{
+public:
+    using value_type = T;
+    using policy_type = Policy;
+    using Dense = SquareMatrix<T, Policy>;
+
+    enum class Structure
+    {
+        Dense,          // n * n values row after row
+        Diagonal,       // n values
+        Symmetric,      // the upper triangle, row after row
+        Upper,          // the upper triangle, row after row
+        Lower,          // the lower triangle column after column, the layout of the transposed upper triangle
+        Sparse,         // CSR: where every row starts, the column of every value, the values
+    };
+
+    // Keeps all n * n values, see fromDense() for picking a compact structure
+    explicit StructuredMatrix(const Dense& dense);
+
+    // Factories for the compact structures, throw std::invalid_argument when the sizes do not fit
+    static StructuredMatrix diagonal(std::vector<T> values);
+    static StructuredMatrix symmetric(int size, std::vector<T> upper);
+    static StructuredMatrix upper(int size, std::vector<T> values);
+    static StructuredMatrix lower(int size, std::vector<T> values);
+    static StructuredMatrix sparse(int size, std::vector<int> rowStarts, std::vector<int> columns, std::vector<T> values);
+
+    // The most compact structure that holds dense exactly
+    static StructuredMatrix fromDense(const Dense& dense);
+
+    Structure structure() const { return m_structure; }
+    int size() const { return m_size; }
+    std::size_t storedCount() const { return m_values->size(); }
+    std::size_t storageBytes() const;
+    T operator()(int i, int j) const;
+    Dense toDense() const;
+
+    StructuredMatrix operator+(const StructuredMatrix& rhs) const;
+    StructuredMatrix operator-(const StructuredMatrix& rhs) const;
+    StructuredMatrix operator*(const T& scalar) const;
+    StructuredMatrix Transpose() const;
+
+private:
+    using Values = std::vector<T>;
+    using Indices = std::vector<int>;
+
+    StructuredMatrix(Structure structure, int size, std::shared_ptr<const Values> values,
+                     std::shared_ptr<const Indices> rowStarts = {}, std::shared_ptr<const Indices> columns = {});
+
+    // Position of (row, column), row <= column, in a triangle stored row after row
+    static std::size_t packedIndex(int size, int row, int column)
+    {
+        const auto r = static_cast<std::size_t>(row);
+        return r * static_cast<std::size_t>(size) - r * (r - 1) / 2 + static_cast<std::size_t>(column - row);
+    }
+
+    // Applies the element kernel to two matrices of one structure (or two that widen to one)
+    template <typename Kernel>
+    StructuredMatrix combine(const StructuredMatrix& rhs, Kernel kernel) const;
+    template <typename Kernel>
+    StructuredMatrix combineSparse(const StructuredMatrix& rhs, Kernel kernel) const;
+
+    // The same matrix in a structure that can hold it (a wider one, or dense)
+    StructuredMatrix as(Structure structure) const;
+
+    Structure m_structure;
+    int m_size;
+    std::shared_ptr<const Values> m_values;
+    std::shared_ptr<const Indices> m_rowStarts;     // sparse only
+    std::shared_ptr<const Indices> m_columns;       // sparse only
+};
+
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy>::StructuredMatrix(Structure structure, int size, std::shared_ptr<const Values> values,
+                                              std::shared_ptr<const Indices> rowStarts, std::shared_ptr<const Indices> columns)
+    : m_structure(structure), m_size(size), m_values(std::move(values)),
+      m_rowStarts(std::move(rowStarts)), m_columns(std::move(columns))
+{
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy>::StructuredMatrix(const Dense& dense)
+    : StructuredMatrix(Structure::Dense, dense.size(),
+                       std::make_shared<const Values>(dense.data(), dense.data() + static_cast<std::size_t>(dense.size()) * static_cast<std::size_t>(dense.size())))
+{
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::diagonal(std::vector<T> values)
+{
+    const auto size = static_cast<int>(values.size());
+    return StructuredMatrix(Structure::Diagonal, size, std::make_shared<const Values>(std::move(values)));
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::symmetric(int size, std::vector<T> upper)
+{
+    auto matrix = StructuredMatrix::upper(size, std::move(upper));
+    matrix.m_structure = Structure::Symmetric;
+    return matrix;
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::upper(int size, std::vector<T> values)
+{
+    if (size < 0 || values.size() != packedIndex(size, size, size))
+        throw std::invalid_argument("A triangle of a matrix of size n holds n * (n + 1) / 2 values");
+    return StructuredMatrix(Structure::Upper, size, std::make_shared<const Values>(std::move(values)));
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::lower(int size, std::vector<T> values)
+{
+    auto matrix = StructuredMatrix::upper(size, std::move(values));
+    matrix.m_structure = Structure::Lower;
+    return matrix;
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::sparse(int size, std::vector<int> rowStarts, std::vector<int> columns, std::vector<T> values)
+{
+    const auto invalid = [] { return std::invalid_argument("Invalid CSR matrix"); };
+    if (size < 0 || rowStarts.size() != static_cast<std::size_t>(size) + 1 || rowStarts.front() != 0
+        || static_cast<std::size_t>(rowStarts.back()) != values.size() || columns.size() != values.size())
+        throw invalid();
+    for (std::size_t i = 0; i < static_cast<std::size_t>(size); ++i)
+    {
+        if (rowStarts[i] > rowStarts[i + 1])
+            throw invalid();
+        // Columns increase within a row, the merge in add and sub depends on it
+        const auto rowBegin = static_cast<std::size_t>(rowStarts[i]);
+        for (auto k = rowBegin; k < static_cast<std::size_t>(rowStarts[i + 1]); ++k)
+        {
+            if (columns[k] < 0 || columns[k] >= size || (k > rowBegin && columns[k] <= columns[k - 1]))
+                throw invalid();
+        }
+    }
+    return StructuredMatrix(Structure::Sparse, size, std::make_shared<const Values>(std::move(values)),
+                            std::make_shared<const Indices>(std::move(rowStarts)), std::make_shared<const Indices>(std::move(columns)));
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::fromDense(const Dense& dense)
+{
+    const int n = dense.size();
+    bool lowerZero = true;
+    bool upperZero = true;
+    bool symmetric = true;
+    std::size_t nonZero = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            const auto value = dense(i, j);
+            nonZero += value != T{};
+            if (i > j)
+            {
+                lowerZero = lowerZero && value == T{};
+                symmetric = symmetric && value == dense(j, i);
+            }
+            else if (i < j)
+                upperZero = upperZero && value == T{};
+        }
+    }
+
+    auto packed = [&](bool lower)
+    {
+        auto values = Values();
+        values.reserve(packedIndex(n, n, n));
+        for (int i = 0; i < n; ++i)
+            for (int j = i; j < n; ++j)
+                values.push_back(lower ? dense(j, i) : dense(i, j));
+        return values;
+    };
+
+    if (lowerZero && upperZero)
+    {
+        auto values = Values();
+        for (int i = 0; i < n; ++i)
+            values.push_back(dense(i, i));
+        return diagonal(std::move(values));
+    }
+    if (lowerZero)
+        return upper(n, packed(false));
+    if (upperZero)
+        return lower(n, packed(true));
+    if (symmetric)
+        return StructuredMatrix::symmetric(n, packed(false));
+    // CSR stores an index next to every value, so it only pays off for a sparse enough matrix
+    if (nonZero * 3 <= static_cast<std::size_t>(n) * static_cast<std::size_t>(n))
+    {
+        auto rowStarts = Indices{ 0 };
+        auto columns = Indices();
+        auto values = Values();
+        for (int i = 0; i < n; ++i)
+        {
+            for (int j = 0; j < n; ++j)
+            {
+                if (dense(i, j) != T{})
+                {
+                    columns.push_back(j);
+                    values.push_back(dense(i, j));
+                }
+            }
+            rowStarts.push_back(static_cast<int>(values.size()));
+        }
+        return sparse(n, std::move(rowStarts), std::move(columns), std::move(values));
+    }
+    return StructuredMatrix(dense);
+}
+
+template <typename T, typename Policy>
+std::size_t StructuredMatrix<T, Policy>::storageBytes() const
+{
+    auto bytes = m_values->size() * sizeof(T);
+    if (m_structure == Structure::Sparse)
+        bytes += (m_rowStarts->size() + m_columns->size()) * sizeof(int);
+    return bytes;
+}
+
+template <typename T, typename Policy>
+T StructuredMatrix<T, Policy>::operator()(int i, int j) const
+{
+    const auto& values = *m_values;
+    switch (m_structure)
+    {
+    case Structure::Dense:
+        return values[static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(j)];
+    case Structure::Diagonal:
+        return i == j ? values[static_cast<std::size_t>(i)] : T{};
+    case Structure::Symmetric:
+        return values[packedIndex(m_size, std::min(i, j), std::max(i, j))];
+    case Structure::Upper:
+        return i <= j ? values[packedIndex(m_size, i, j)] : T{};
+    case Structure::Lower:
+        return i >= j ? values[packedIndex(m_size, j, i)] : T{};
+    case Structure::Sparse:
+    {
+        const auto first = m_columns->begin() + (*m_rowStarts)[static_cast<std::size_t>(i)];
+        const auto last = m_columns->begin() + (*m_rowStarts)[static_cast<std::size_t>(i) + 1];
+        const auto found = std::lower_bound(first, last, j);
+        return found != last && *found == j ? values[static_cast<std::size_t>(found - m_columns->begin())] : T{};
+    }
+    }
+    return T{};
+}
+
+template <typename T, typename Policy>
+typename StructuredMatrix<T, Policy>::Dense StructuredMatrix<T, Policy>::toDense() const
+{
+    auto dense = Dense(m_size, T{});
+    const auto& values = *m_values;
+    switch (m_structure)
+    {
+    case Structure::Dense:
+        std::copy(values.begin(), values.end(), dense.data());
+        break;
+    case Structure::Diagonal:
+        for (int i = 0; i < m_size; ++i)
+            dense(i, i) = values[static_cast<std::size_t>(i)];
+        break;
+    case Structure::Symmetric:
+    case Structure::Upper:
+    case Structure::Lower:
+    {
+        std::size_t k = 0;
+        for (int i = 0; i < m_size; ++i)
+        {
+            for (int j = i; j < m_size; ++j, ++k)
+            {
+                if (m_structure != Structure::Lower)
+                    dense(i, j) = values[k];
+                if (m_structure != Structure::Upper)
+                    dense(j, i) = values[k];
+            }
+        }
+        break;
+    }
+    case Structure::Sparse:
+        for (int i = 0; i < m_size; ++i)
+        {
+            const auto row = static_cast<std::size_t>(i);
+            for (auto k = static_cast<std::size_t>((*m_rowStarts)[row]); k < static_cast<std::size_t>((*m_rowStarts)[row + 1]); ++k)
+                dense(i, (*m_columns)[k]) = values[k];
+        }
+        break;
+    }
+    return dense;
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::as(Structure structure) const
+{
+    if (structure == m_structure)
+        return *this;
+
+    if (m_structure == Structure::Diagonal && structure != Structure::Dense)
+    {
+        if (structure == Structure::Sparse)
+        {
+            auto rowStarts = Indices();
+            auto columns = Indices();
+            for (int i = 0; i <= m_size; ++i)
+                rowStarts.push_back(i);
+            for (int i = 0; i < m_size; ++i)
+                columns.push_back(i);
+            return StructuredMatrix(Structure::Sparse, m_size, m_values,
+                                    std::make_shared<const Indices>(std::move(rowStarts)), std::make_shared<const Indices>(std::move(columns)));
+        }
+        // Symmetric, upper and lower all keep the diagonal at the same places
+        auto values = Values(packedIndex(m_size, m_size, m_size), T{});
+        for (int i = 0; i < m_size; ++i)
+            values[packedIndex(m_size, i, i)] = (*m_values)[static_cast<std::size_t>(i)];
+        return StructuredMatrix(structure, m_size, std::make_shared<const Values>(std::move(values)));
+    }
+    return StructuredMatrix(toDense());
+}
+
+template <typename T, typename Policy>
+template <typename Kernel>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::combine(const StructuredMatrix& rhs, Kernel kernel) const
+{
+    if (m_size != rhs.m_size)
+        throw std::invalid_argument("The matrices must have the same size");
+
+    // A diagonal widens to the structure of the other matrix, any other mix becomes dense
+    auto target = Structure::Dense;
+    if (m_structure == rhs.m_structure)
+        target = m_structure;
+    else if (m_structure == Structure::Diagonal)
+        target = rhs.m_structure;
+    else if (rhs.m_structure == Structure::Diagonal)
+        target = m_structure;
+
+    const auto lhs = as(target);
+    const auto other = rhs.as(target);
+    if (target == Structure::Sparse)
+        return lhs.combineSparse(other, kernel);
+
+    auto values = *lhs.m_values;
+    kernel(values.data(), other.m_values->data(), values.size());
+    return StructuredMatrix(target, m_size, std::make_shared<const Values>(std::move(values)));
+}
+
+template <typename T, typename Policy>
+template <typename Kernel>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::combineSparse(const StructuredMatrix& rhs, Kernel kernel) const
+{
+    // Merge the rows into the union of both patterns, with a zero where one side has no
+    // value, then run the kernel over the aligned values in one go
+    auto rowStarts = Indices{ 0 };
+    auto columns = Indices();
+    auto values = Values();
+    auto others = Values();
+    const auto& lhsValues = *m_values;
+    const auto& rhsValues = *rhs.m_values;
+    for (int i = 0; i < m_size; ++i)
+    {
+        const auto row = static_cast<std::size_t>(i);
+        auto a = static_cast<std::size_t>((*m_rowStarts)[row]);
+        auto b = static_cast<std::size_t>((*rhs.m_rowStarts)[row]);
+        const auto aEnd = static_cast<std::size_t>((*m_rowStarts)[row + 1]);
+        const auto bEnd = static_cast<std::size_t>((*rhs.m_rowStarts)[row + 1]);
+        while (a < aEnd || b < bEnd)
+        {
+            const int aColumn = a < aEnd ? (*m_columns)[a] : m_size;
+            const int bColumn = b < bEnd ? (*rhs.m_columns)[b] : m_size;
+            const int column = std::min(aColumn, bColumn);
+            columns.push_back(column);
+            values.push_back(aColumn == column ? lhsValues[a++] : T{});
+            others.push_back(bColumn == column ? rhsValues[b++] : T{});
+        }
+        rowStarts.push_back(static_cast<int>(columns.size()));
+    }
+    kernel(values.data(), others.data(), values.size());
+    return StructuredMatrix(Structure::Sparse, m_size, std::make_shared<const Values>(std::move(values)),
+                            std::make_shared<const Indices>(std::move(rowStarts)), std::make_shared<const Indices>(std::move(columns)));
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::operator+(const StructuredMatrix& rhs) const
+{
+    return combine(rhs, detail::addValues<T, Policy>);
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::operator-(const StructuredMatrix& rhs) const
+{
+    return combine(rhs, detail::subValues<T, Policy>);
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::operator*(const T& scalar) const
+{
+    auto values = *m_values;
+    detail::scaleValues<T, Policy>(values.data(), values.size(), scalar);
+    return StructuredMatrix(m_structure, m_size, std::make_shared<const Values>(std::move(values)), m_rowStarts, m_columns);
+}
+
+template <typename T, typename Policy>
+StructuredMatrix<T, Policy> StructuredMatrix<T, Policy>::Transpose() const
+{
+    switch (m_structure)
+    {
+    case Structure::Diagonal:
+    case Structure::Symmetric:
+        return *this;
+    case Structure::Upper:
+        return StructuredMatrix(Structure::Lower, m_size, m_values);
+    case Structure::Lower:
+        return StructuredMatrix(Structure::Upper, m_size, m_values);
+    case Structure::Sparse:
+    {
+        // Counting sort of the values by column; rows are visited in order, so the
+        // columns of the transposed rows come out sorted
+        auto rowStarts = Indices(static_cast<std::size_t>(m_size) + 1, 0);
+        for (const int column : *m_columns)
+            ++rowStarts[static_cast<std::size_t>(column) + 1];
+        for (int i = 0; i < m_size; ++i)
+            rowStarts[static_cast<std::size_t>(i) + 1] += rowStarts[static_cast<std::size_t>(i)];
+        auto next = Indices(rowStarts.begin(), rowStarts.end() - 1);
+        auto columns = Indices(m_columns->size());
+        auto values = Values(m_values->size());
+        for (int i = 0; i < m_size; ++i)
+        {
+            const auto row = static_cast<std::size_t>(i);
+            for (auto k = static_cast<std::size_t>((*m_rowStarts)[row]); k < static_cast<std::size_t>((*m_rowStarts)[row + 1]); ++k)
+            {
+                const int position = next[static_cast<std::size_t>((*m_columns)[k])]++;
+                columns[static_cast<std::size_t>(position)] = i;
+                values[static_cast<std::size_t>(position)] = (*m_values)[k];
+            }
+        }
+        return StructuredMatrix(Structure::Sparse, m_size, std::make_shared<const Values>(std::move(values)),
+                                std::make_shared<const Indices>(std::move(rowStarts)), std::make_shared<const Indices>(std::move(columns)));
+    }
+    case Structure::Dense:
+        break;
+    }
+    return StructuredMatrix(toDense().Transpose());
+}
+
+template <typename T, typename Policy>
+std::ostream& operator<<(std::ostream& ostr, const StructuredMatrix<T, Policy>& matrix)
+{
+    for (int i = 0; i < matrix.size(); ++i)
+    {
+        for (int j = 0; j < matrix.size(); ++j)
+        {
+            ostr << matrix(i, j) << ' ';
+        }
+        ostr << '\n';
+    }
+    return ostr;
+}
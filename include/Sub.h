@@ -5,11 +5,23 @@
 #include <memory>
 
 
-class Sub : public BinaryOperation
+template <typename M>
+class BasicSub : public BasicBinaryOperation<M>
 {
 public:
-    using BinaryOperation::BinaryOperation;
+    using T = typename BasicOperation<M>::T;
+    using S = typename BasicOperation<M>::S;
+    using Ref = typename BasicOperation<M>::Ref;
+    using ConstRef = typename BasicOperation<M>::ConstRef;
+    using BasicBinaryOperation<M>::BasicBinaryOperation;
+    OperationBase::Kind kind() const override { return OperationBase::Kind::Sub; }
+    std::size_t objectBytes() const override { return sizeof(*this); }
     T compute(const std::vector<T>& input) const override;
+    S computeStructured(const std::vector<S>& input) const override;
+    std::optional<EvalFault> tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const override;
+    std::size_t scratchBytes(int size) const override;
     void printSymbol(std::ostream& ostr) const override;
 
 };
+
+using Sub = BasicSub<Operation::T>;
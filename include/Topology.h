@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+// The machine layout the parallel evaluation places its workers by: the CPUs of every
+// NUMA node and the size of the L2 cache one worker has to itself.
+// Read once from /sys and sysconf; on other systems (or when /sys is missing) the
+// machine is one node holding every hardware thread.
+class Topology
+{
+public:
+    static const Topology& current();
+
+    int nodeCount() const { return static_cast<int>(m_nodes.size()); }
+    const std::vector<int>& cpus(int node) const { return m_nodes[static_cast<std::size_t>(node)]; }
+    std::size_t l2Bytes() const { return m_l2Bytes; }
+
+    // Spreads consecutive workers over the nodes first, then over the CPUs of each node
+    int nodeForWorker(int worker) const;
+    int cpuForWorker(int worker) const;
+
+    // Restricts the calling thread to one CPU; false when the system does not allow it
+    static bool pinCurrentThread(int cpu);
+
+private:
+    Topology();
+
+    std::vector<std::vector<int>> m_nodes;
+    std::size_t m_l2Bytes;
+};
@@ -3,14 +3,24 @@
 #include "UnaryOperation.h"
 
 
-// Represents the identity operation
-// Returns the same set that it gets as input
-// Used as the leaf in every operation tree
-class Transpose : public UnaryOperation
+// Represents the transpose operation
+// Returns the input matrix with its rows and columns swapped
+template <typename M>
+class BasicTranspose : public BasicUnaryOperation<M>
 {
 public:
-    using UnaryOperation::UnaryOperation;
+    using T = typename BasicOperation<M>::T;
+    using S = typename BasicOperation<M>::S;
+    using Ref = typename BasicOperation<M>::Ref;
+    using ConstRef = typename BasicOperation<M>::ConstRef;
+    using BasicUnaryOperation<M>::BasicUnaryOperation;
+    OperationBase::Kind kind() const override { return OperationBase::Kind::Transpose; }
+    std::size_t objectBytes() const override { return sizeof(*this); }
     T compute(const std::vector<T>& input) const override;
+    S computeStructured(const std::vector<S>& input) const override;
+    std::optional<EvalFault> tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 };
+
+using Transpose = BasicTranspose<Operation::T>;
@@ -5,12 +5,11 @@
 #include <memory>
 
 
-class UnaryOperation : public Operation
+template <typename M>
+class BasicUnaryOperation : public BasicOperation<M>
 {
 public:
-    UnaryOperation();
+    BasicUnaryOperation();
     int inputCount() const override;
-    ~UnaryOperation() override = 0
-    {
-    }
+    ~BasicUnaryOperation() override = 0;
 };
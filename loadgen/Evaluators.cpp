@@ -0,0 +1,207 @@
+#include "Evaluators.h"
+#include "FunctionCalculator.h"
+#include "EvalSession.h"
+#include "EvalPipeline.h"
+
+#include <sstream>
+#include <stdexcept>
+
+
+namespace
+{
+    Outcome computeOutcome(const Workload& workload, int node, const std::vector<Operation::T>& input)
+    {
+        try
+        {
+            return workload.operations[static_cast<std::size_t>(node)]->compute(input);
+        }
+        catch (const std::out_of_range&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    // Starts a session with one input zeroed, then puts the real input back so the
+    // result comes from an incremental update (and, when the zeroed state fails, a retry)
+    Outcome sessionOutcome(const Workload& workload, int node, const std::vector<Operation::T>& input)
+    {
+        const int slot = static_cast<int>(input.size()) / 2;
+        auto initial = input;
+        initial[static_cast<std::size_t>(slot)] = Operation::T(input.front().size(), 0);
+        auto session = EvalSession(workload.operations[static_cast<std::size_t>(node)], std::move(initial));
+        try
+        {
+            session.recompute();
+        }
+        catch (const std::out_of_range&)
+        {
+        }
+
+        try
+        {
+            session.setInput(slot, input[static_cast<std::size_t>(slot)]);
+            session.recompute();
+            return session.result();
+        }
+        catch (const std::out_of_range&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    // Evaluates on the most compact structure of every input, see StructuredMatrix
+    Outcome structuredOutcome(const Workload& workload, int node, const std::vector<Operation::T>& input)
+    {
+        auto structured = std::vector<Operation::S>();
+        for (const auto& matrix : input)
+            structured.push_back(Operation::S::fromDense(matrix));
+        try
+        {
+            return workload.operations[static_cast<std::size_t>(node)]->computeStructured(structured).toDense();
+        }
+        catch (const std::out_of_range&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    // Evaluates into a preallocated result with exactly the scratch memory the operation asks for
+    Outcome computeIntoOutcome(const Workload& workload, int node, const std::vector<Operation::T>& input)
+    {
+        const auto& operation = workload.operations[static_cast<std::size_t>(node)];
+        const int size = input.front().size();
+        const auto views = std::vector<Operation::ConstRef>(input.begin(), input.end());
+        auto result = Operation::T(size, 0);
+        auto scratch = Scratch(operation->scratchBytes(size));
+        try
+        {
+            operation->computeInto(views, result, scratch);
+            return result;
+        }
+        catch (const std::out_of_range&)
+        {
+            return std::nullopt;
+        }
+    }
+
+    // The status-code API: an overflow must come back as a fault naming an element of the result
+    Outcome tryComputeOutcome(const Workload& workload, int node, const std::vector<Operation::T>& input)
+    {
+        const auto result = workload.operations[static_cast<std::size_t>(node)]->tryCompute(input);
+        if (result)
+            return *result;
+        const auto& fault = result.error();
+        const int size = input.front().size();
+        // Every operation of the workload has its own kernels, which all know the element
+        if (!fault.node || !fault.element)
+            throw std::logic_error("tryCompute reported a fault without its element");
+        const auto& element = *fault.element;
+        if (element.row < 0 || element.row >= size || element.col < 0 || element.col >= size)
+            throw std::logic_error("tryCompute reported a fault outside the result");
+        return std::nullopt;
+    }
+
+    // The result the calculator or a batch printed after " = ", std::nullopt for a range error
+    Outcome printedOutcome(const std::string& text, int size, const char* source)
+    {
+        if (text.find("Matrix value is out of range") != std::string::npos)
+            return std::nullopt;
+        const auto resultPos = text.rfind(" = \n");
+        if (resultPos == std::string::npos)
+            throw std::runtime_error(std::string(source) + " produced no result");
+
+        auto resultText = std::istringstream(text.substr(resultPos + 4));
+        auto result = Operation::T(size, 0);
+        for (int i = 0; i < size; ++i)
+            for (int j = 0; j < size; ++j)
+                resultText >> result(i, j);
+        return result;
+    }
+
+    // Runs a one set batch with placement on and every row of the inputs on a line of its
+    // own, so the evaluator parses the tokens the pipeline cut out of the stream
+    Outcome pipelineOutcome(const Workload& workload, int node, const std::vector<Operation::T>& input)
+    {
+        const int size = input.front().size();
+        auto text = std::ostringstream();
+        for (const auto& matrix : input)
+        {
+            for (int i = 0; i < size; ++i)
+            {
+                for (int j = 0; j < size; ++j)
+                    text << (j == 0 ? "" : " ") << matrix(i, j);
+                text << '\n';
+            }
+        }
+
+        auto in = std::istringstream(text.str());
+        auto out = std::ostringstream();
+        EvalPipeline(*workload.operations[static_cast<std::size_t>(node)], size, { 1, 4, true }).run(in, out, 1);
+        return printedOutcome(out.str(), size, "batch");
+    }
+
+    // Writes the commands that rebuild the workload and returns the calculator index of every node
+    std::vector<int> writeDefinitions(std::ostream& script, const Workload& workload)
+    {
+        auto indices = std::vector<int>();
+        int next = 2;
+        for (const auto& spec : workload.nodes)
+        {
+            switch (spec.kind)
+            {
+            case NodeSpec::Kind::Identity: indices.push_back(0); continue;
+            case NodeSpec::Kind::Transpose: indices.push_back(1); continue;
+            case NodeSpec::Kind::Scalar: script << "scal " << spec.scalar; break;
+            case NodeSpec::Kind::Add: script << "add"; break;
+            case NodeSpec::Kind::Sub: script << "sub"; break;
+            case NodeSpec::Kind::Comp: script << "comp"; break;
+            }
+            if (spec.kind != NodeSpec::Kind::Scalar)
+            {
+                script << ' ' << indices[static_cast<std::size_t>(spec.first)]
+                       << ' ' << indices[static_cast<std::size_t>(spec.second)];
+            }
+            script << '\n';
+            indices.push_back(next++);
+        }
+        return indices;
+    }
+}
+
+
+std::vector<Evaluator> makeEvaluators()
+{
+    return
+    {
+        { "compute", computeOutcome },
+        { "session", sessionOutcome },
+        { "structured", structuredOutcome },
+        { "compute_into", computeIntoOutcome },
+        { "try_compute", tryComputeOutcome },
+        { "pipeline_rows", pipelineOutcome },
+    };
+}
+
+
+Outcome evalThroughCalculator(const Workload& workload, int node, const std::vector<Operation::T>& input)
+{
+    auto script = std::ostringstream();
+    script << "100\n";
+    const auto indices = writeDefinitions(script, workload);
+
+    const int size = input.front().size();
+    script << "eval " << indices[static_cast<std::size_t>(node)] << ' ' << size << '\n';
+    for (const auto& matrix : input)
+    {
+        for (int i = 0; i < size * size; ++i)
+            script << (i == 0 ? "" : " ") << matrix(i / size, i % size);
+        script << '\n';
+    }
+    script << "exit\n";
+
+    auto in = std::istringstream(script.str());
+    auto out = std::ostringstream();
+    FunctionCalculator(in, out).run();
+
+    return printedOutcome(out.str(), size, "calculator");
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Generator.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// One way of evaluating a workload node; every one of them must agree with referenceEval
+struct Evaluator
+{
+    using Function = std::function<Outcome(const Workload& workload, int node, const std::vector<Operation::T>& input)>;
+
+    std::string name;
+    Function run;
+};
+
+
+// The evaluators compared against the reference, the first one is Operation::compute
+std::vector<Evaluator> makeEvaluators();
+
+// Defines the workload through the calculator commands and evaluates node like a user session would
+Outcome evalThroughCalculator(const Workload& workload, int node, const std::vector<Operation::T>& input);
+
+// Largest workload (without id and tran) the calculator can hold
+constexpr int maxCalculatorOperations = 98;
@@ -0,0 +1,243 @@
+#include "Generator.h"
+#include "Add.h"
+#include "Comp.h"
+#include "Identity.h"
+#include "Scalar.h"
+#include "Sub.h"
+#include "Transpose.h"
+
+
+namespace
+{
+    constexpr long long maxValue = 1000;
+    constexpr long long minValue = -1024;
+
+    // Row-major matrix of wide integers, so the reference never overflows
+    struct RefMatrix
+    {
+        int size = 0;
+        std::vector<long long> values;
+    };
+
+    RefMatrix toRef(const Operation::T& matrix)
+    {
+        auto ref = RefMatrix{ matrix.size(), {} };
+        for (int i = 0; i < matrix.size(); ++i)
+            for (int j = 0; j < matrix.size(); ++j)
+                ref.values.push_back(matrix(i, j));
+        return ref;
+    }
+
+    std::optional<RefMatrix> evalNode(const Workload& workload, int node, std::span<const RefMatrix> input)
+    {
+        const auto& spec = workload.nodes[static_cast<std::size_t>(node)];
+        switch (spec.kind)
+        {
+        case NodeSpec::Kind::Identity:
+            return input.front();
+
+        case NodeSpec::Kind::Transpose:
+        {
+            auto result = input.front();
+            const int n = result.size;
+            for (int i = 0; i < n; ++i)
+                for (int j = 0; j < n; ++j)
+                    result.values[static_cast<std::size_t>(i * n + j)] = input.front().values[static_cast<std::size_t>(j * n + i)];
+            return result;
+        }
+
+        case NodeSpec::Kind::Scalar:
+        {
+            auto result = input.front();
+            for (auto& value : result.values)
+            {
+                value *= spec.scalar;
+                if (value < minValue || value > maxValue)
+                    return std::nullopt;
+            }
+            return result;
+        }
+
+        case NodeSpec::Kind::Add:
+        case NodeSpec::Kind::Sub:
+        {
+            const auto firstCount = static_cast<std::size_t>(workload.nodes[static_cast<std::size_t>(spec.first)].inputCount);
+            auto a = evalNode(workload, spec.first, input.first(firstCount));
+            if (!a)
+                return std::nullopt;
+            auto b = evalNode(workload, spec.second, input.subspan(firstCount));
+            if (!b)
+                return std::nullopt;
+            for (std::size_t k = 0; k < a->values.size(); ++k)
+            {
+                if (spec.kind == NodeSpec::Kind::Add)
+                {
+                    a->values[k] += b->values[k];
+                    if (a->values[k] > maxValue)
+                        return std::nullopt;
+                }
+                else
+                {
+                    a->values[k] -= b->values[k];
+                    if (a->values[k] < minValue)
+                        return std::nullopt;
+                }
+            }
+            return a;
+        }
+
+        case NodeSpec::Kind::Comp:
+        {
+            const auto firstCount = static_cast<std::size_t>(workload.nodes[static_cast<std::size_t>(spec.first)].inputCount);
+            auto a = evalNode(workload, spec.first, input.first(firstCount));
+            if (!a)
+                return std::nullopt;
+            auto secondInput = std::vector<RefMatrix>{ *a };
+            secondInput.insert(secondInput.end(), input.begin() + static_cast<std::ptrdiff_t>(firstCount), input.end());
+            return evalNode(workload, spec.second, secondInput);
+        }
+        }
+        return std::nullopt;
+    }
+}
+
+
+Generator::Generator(std::uint64_t seed)
+    : m_engine(seed)
+{
+}
+
+
+Workload Generator::makeWorkload(int nodeCount, int maxInputs)
+{
+    auto workload = Workload();
+    workload.nodes.push_back({ NodeSpec::Kind::Identity });
+    workload.operations.push_back(std::make_shared<Identity>());
+    workload.nodes.push_back({ NodeSpec::Kind::Transpose });
+    workload.operations.push_back(std::make_shared<Transpose>());
+
+    auto kindDist = std::uniform_int_distribution<int>(0, 5);
+    auto scalarDist = std::uniform_int_distribution<int>(-3, 3);
+
+    while (static_cast<int>(workload.nodes.size()) < nodeCount + 2)
+    {
+        const auto kind = static_cast<NodeSpec::Kind>(kindDist(m_engine));
+        auto spec = NodeSpec{ kind };
+        switch (kind)
+        {
+        case NodeSpec::Kind::Identity:
+            workload.operations.push_back(std::make_shared<Identity>());
+            break;
+        case NodeSpec::Kind::Transpose:
+            workload.operations.push_back(std::make_shared<Transpose>());
+            break;
+        case NodeSpec::Kind::Scalar:
+            spec.scalar = scalarDist(m_engine);
+            workload.operations.push_back(std::make_shared<Scalar>(spec.scalar));
+            break;
+        default:
+        {
+            spec.first = pickNode(workload);
+            spec.second = pickNode(workload);
+            const auto& first = workload.nodes[static_cast<std::size_t>(spec.first)];
+            const auto& second = workload.nodes[static_cast<std::size_t>(spec.second)];
+            spec.inputCount = first.inputCount + second.inputCount - (kind == NodeSpec::Kind::Comp ? 1 : 0);
+            if (spec.inputCount > maxInputs)
+                continue;
+
+            const auto& a = workload.operations[static_cast<std::size_t>(spec.first)];
+            const auto& b = workload.operations[static_cast<std::size_t>(spec.second)];
+            if (kind == NodeSpec::Kind::Add)
+                workload.operations.push_back(std::make_shared<Add>(a, b));
+            else if (kind == NodeSpec::Kind::Sub)
+                workload.operations.push_back(std::make_shared<Sub>(a, b));
+            else
+                workload.operations.push_back(std::make_shared<Comp>(a, b));
+            break;
+        }
+        }
+        workload.nodes.push_back(spec);
+    }
+    return workload;
+}
+
+
+int Generator::pickNode(const Workload& workload)
+{
+    // Favour recent nodes so the trees get deep, but keep every node reachable
+    const int count = static_cast<int>(workload.nodes.size());
+    auto recent = std::uniform_int_distribution<int>(std::max(0, count - 8), count - 1);
+    auto any = std::uniform_int_distribution<int>(0, count - 1);
+    return std::bernoulli_distribution(0.7)(m_engine) ? recent(m_engine) : any(m_engine);
+}
+
+
+std::vector<Operation::T> Generator::makeInputs(int count, int size)
+{
+    // Mostly small values, sometimes the full range to exercise the out of range paths
+    auto small = std::uniform_int_distribution<int>(-8, 8);
+    auto full = std::uniform_int_distribution<int>(-1024, 1000);
+    const bool wide = std::bernoulli_distribution(0.1)(m_engine);
+
+    auto inputs = std::vector<Operation::T>();
+    for (int k = 0; k < count; ++k)
+    {
+        auto matrix = Operation::T(size, 0);
+        for (int i = 0; i < size; ++i)
+            for (int j = 0; j < size; ++j)
+                matrix(i, j) = wide ? full(m_engine) : small(m_engine);
+
+        // Half of the matrices get a structure, so every StructuredMatrix form shows up
+        const auto shape = std::uniform_int_distribution<int>(0, 9)(m_engine);
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+            {
+                switch (shape)
+                {
+                case 0: if (i != j) matrix(i, j) = 0; break;                    // diagonal
+                case 1: if (i > j) matrix(i, j) = 0; break;                     // upper
+                case 2: if (i < j) matrix(i, j) = 0; break;                     // lower
+                case 3: if (i > j) matrix(i, j) = matrix(j, i); break;          // symmetric
+                case 4: if (m_engine() % 4 != 0) matrix(i, j) = 0; break;       // sparse
+                default: break;
+                }
+            }
+        }
+        inputs.push_back(matrix);
+    }
+    return inputs;
+}
+
+
+Outcome referenceEval(const Workload& workload, int node, std::span<const Operation::T> input)
+{
+    auto refInput = std::vector<RefMatrix>();
+    for (const auto& matrix : input)
+        refInput.push_back(toRef(matrix));
+
+    const auto result = evalNode(workload, node, refInput);
+    if (!result)
+        return std::nullopt;
+
+    const int n = result->size;
+    auto matrix = Operation::T(n, 0);
+    for (int i = 0; i < n; ++i)
+        for (int j = 0; j < n; ++j)
+            matrix(i, j) = static_cast<int>(result->values[static_cast<std::size_t>(i * n + j)]);
+    return matrix;
+}
+
+
+bool sameOutcome(const Outcome& lhs, const Outcome& rhs)
+{
+    if (!lhs || !rhs)
+        return !lhs && !rhs;
+    if (lhs->size() != rhs->size())
+        return false;
+    for (int i = 0; i < lhs->size(); ++i)
+        for (int j = 0; j < lhs->size(); ++j)
+            if ((*lhs)(i, j) != (*rhs)(i, j))
+                return false;
+    return true;
+}
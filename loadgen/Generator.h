@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <vector>
+
+
+// Plain description of one generated node, kept next to the real Operation so that
+// the reference evaluator does not depend on the classes it checks
+struct NodeSpec
+{
+    enum class Kind { Identity, Transpose, Scalar, Add, Sub, Comp };
+
+    Kind kind;
+    int scalar = 0;
+    int first = -1;     // indices into Workload::nodes
+    int second = -1;
+    int inputCount = 1;
+};
+
+
+struct Workload
+{
+    std::vector<NodeSpec> nodes;
+    std::vector<std::shared_ptr<Operation>> operations;   // same indices as nodes
+};
+
+
+// The result of an evaluation, std::nullopt when a value left the allowed range
+using Outcome = std::optional<Operation::T>;
+
+
+// Seeded source of random operation DAGs and matching inputs.
+// The same seed and parameters always produce the same workload and input stream.
+class Generator
+{
+public:
+    explicit Generator(std::uint64_t seed);
+
+    // Starts from id and tran (like FunctionCalculator) and adds nodeCount random nodes.
+    // Children are picked among the existing nodes, so subtrees are shared.
+    Workload makeWorkload(int nodeCount, int maxInputs);
+
+    int pickNode(const Workload& workload);
+    std::vector<Operation::T> makeInputs(int count, int size);
+
+private:
+    std::mt19937_64 m_engine;
+};
+
+
+// Straightforward evaluation of the spec with the range rules of SquareMatrix
+Outcome referenceEval(const Workload& workload, int node, std::span<const Operation::T> input);
+
+bool sameOutcome(const Outcome& lhs, const Outcome& rhs);
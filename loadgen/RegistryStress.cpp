@@ -0,0 +1,128 @@
+#include "RegistryStress.h"
+#include "OperationRegistry.h"
+#include "Comp.h"
+#include "Identity.h"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+
+RegistryStressResult runRegistryStress(const Workload& workload, Generator& generator,
+                                       int readers, int requests, int size)
+{
+    // The workload stays at the front of the list; the writer only changes what follows it
+    const auto stable = workload.operations.size();
+    auto origin = std::unordered_map<const OperationBase*, std::size_t>();
+    auto inputs = std::vector<std::vector<Operation::T>>();
+    auto expected = std::vector<Outcome>();
+    for (std::size_t i = 0; i < stable; ++i)
+    {
+        origin.emplace(workload.operations[i].get(), i);
+        inputs.push_back(generator.makeInputs(workload.nodes[i].inputCount, size));
+        expected.push_back(referenceEval(workload, static_cast<int>(i), inputs.back()));
+    }
+
+    auto registry = OperationRegistry(workload.operations);
+    auto result = RegistryStressResult();
+    auto mismatches = std::atomic<int>(0);
+    auto inconsistent = std::atomic<int>(0);
+    auto finishedReaders = std::atomic<int>(0);
+    const auto start = std::chrono::steady_clock::now();
+
+    // id -> node and node -> id evaluate exactly like node, so the wrappers have known results
+    auto removed = std::vector<std::weak_ptr<Operation>>();
+    auto writer = std::jthread([&]
+    {
+        auto engine = std::mt19937_64(stable);
+        while (finishedReaders.load(std::memory_order_relaxed) < readers)
+        {
+            const auto extra = registry.size() - stable;
+            const auto action = engine() % 20;
+            if (extra < 256 && action < 12)
+            {
+                const auto& node = workload.operations[engine() % stable];
+                if (action % 2 == 0)
+                    registry.add(std::make_shared<Comp>(std::make_shared<Identity>(), node));
+                else
+                    registry.add(std::make_shared<Comp>(node, std::make_shared<Identity>()));
+            }
+            else if (extra > 0 && action < 19)
+            {
+                const auto index = stable + engine() % extra;
+                removed.push_back(registry.at(index));
+                registry.erase(index);
+            }
+            else
+            {
+                const auto snapshot = registry.snapshot();
+                removed.insert(removed.end(), snapshot->begin() + static_cast<std::ptrdiff_t>(stable), snapshot->end());
+                registry.truncate(stable);
+            }
+        }
+    });
+
+    {
+        auto threads = std::vector<std::jthread>();
+        for (int reader = 0; reader < readers; ++reader)
+        {
+            const int count = requests / readers + (reader < requests % readers);
+            threads.emplace_back([&, reader, count]
+            {
+                auto engine = std::mt19937_64(static_cast<std::uint64_t>(reader) + 1);
+                for (int request = 0; request < count; ++request)
+                {
+                    const auto snapshot = registry.snapshot();
+                    const auto& operations = *snapshot;
+                    const auto check = engine() % stable;
+                    if (operations.size() < stable || operations[check] != workload.operations[check])
+                    {
+                        ++inconsistent;
+                        continue;
+                    }
+
+                    const auto& operation = operations[engine() % operations.size()];
+                    auto node = origin.find(operation.get());
+                    if (node == origin.end())
+                    {
+                        // A wrapper, the workload node is the child that is not its own identity
+                        const auto children = operation->children();
+                        node = origin.find(children[0]);
+                        if (node == origin.end())
+                            node = origin.find(children[1]);
+                    }
+
+                    auto outcome = Outcome();
+                    try
+                    {
+                        outcome = operation->compute(inputs[node->second]);
+                    }
+                    catch (const std::out_of_range&)
+                    {
+                    }
+                    if (!sameOutcome(expected[node->second], outcome))
+                        ++mismatches;
+                }
+                ++finishedReaders;
+            });
+        }
+    }
+    writer.join();
+
+    // Readers and writer are done, so nothing may hold a removed operation any more
+    for (const auto& operation : removed)
+    {
+        if (!operation.expired())
+            ++result.unreclaimed;
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.reads = requests;
+    result.versions = registry.version();
+    result.mismatches = mismatches;
+    result.inconsistent = inconsistent;
+    return result;
+}
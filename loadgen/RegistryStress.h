@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Generator.h"
+
+#include <cstdint>
+
+
+// Many threads evaluate against OperationRegistry snapshots while one thread keeps
+// adding and removing operations. Every evaluation is checked against referenceEval,
+// every snapshot against the list the writer is known to keep stable, and at the end
+// every removed operation must have been freed.
+struct RegistryStressResult
+{
+    std::int64_t reads = 0;
+    std::uint64_t versions = 0;     // lists published by the writer
+    int mismatches = 0;             // results that differ from the reference
+    int inconsistent = 0;           // snapshots whose stable part was changed
+    int unreclaimed = 0;            // removed operations still alive after all readers finished
+    double seconds = 0;
+};
+
+
+RegistryStressResult runRegistryStress(const Workload& workload, Generator& generator,
+                                       int readers, int requests, int size);
@@ -0,0 +1,172 @@
+#include "Evaluators.h"
+#include "Generator.h"
+#include "RegistryStress.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+
+namespace
+{
+    struct Options
+    {
+        std::uint64_t seed = 1;
+        int operations = 40;
+        int maxInputs = 16;
+        int size = 5;
+        int requests = 10000;
+        double rate = 0;            // requests per second, 0 runs as fast as possible
+        bool calculator = false;    // drive through FunctionCalculator instead of the Operation API
+        bool registry = false;      // stress OperationRegistry with concurrent readers and a writer
+        int threads = 0;            // readers of the registry driver, 0 uses one per hardware thread
+    };
+
+    Options parseOptions(int argc, char* argv[])
+    {
+        auto options = Options();
+        for (int i = 1; i < argc; i += 2)
+        {
+            const auto option = std::string(argv[i]);
+            if (i + 1 == argc)
+                throw std::invalid_argument("Missing value for option: " + option);
+            const auto value = std::string(argv[i + 1]);
+            if (option == "--seed") options.seed = std::stoull(value);
+            else if (option == "--ops") options.operations = std::stoi(value);
+            else if (option == "--max-inputs") options.maxInputs = std::max(1, std::stoi(value));
+            else if (option == "--size") options.size = std::max(1, std::stoi(value));
+            else if (option == "--requests") options.requests = std::max(1, std::stoi(value));
+            else if (option == "--rate") options.rate = std::stod(value);
+            else if (option == "--threads") options.threads = std::max(0, std::stoi(value));
+            else if (option == "--driver")
+            {
+                if (value != "api" && value != "calculator" && value != "registry")
+                    throw std::invalid_argument("Unknown driver: " + value);
+                options.calculator = value == "calculator";
+                options.registry = value == "registry";
+            }
+            else throw std::invalid_argument("Unknown option: " + option);
+        }
+        if (options.calculator && (options.operations > maxCalculatorOperations || options.size > 5))
+            throw std::invalid_argument("The calculator driver holds at most 98 operations of size 1 - 5");
+        if (options.threads == 0)
+            options.threads = static_cast<int>(std::max(2u, std::thread::hardware_concurrency()) - 1);
+        return options;
+    }
+
+    int runRegistryDriver(const Options& options, const Workload& workload, Generator& generator)
+    {
+        const auto result = runRegistryStress(workload, generator, options.threads, options.requests, options.size);
+        std::cout << "{\n"
+                  << "  \"seed\": " << options.seed << ",\n"
+                  << "  \"driver\": \"registry\",\n"
+                  << "  \"operations\": " << workload.nodes.size() << ",\n"
+                  << "  \"readers\": " << options.threads << ",\n"
+                  << "  \"requests\": " << result.reads << ",\n"
+                  << "  \"versions\": " << result.versions << ",\n"
+                  << "  \"mismatches\": " << result.mismatches << ",\n"
+                  << "  \"inconsistent_snapshots\": " << result.inconsistent << ",\n"
+                  << "  \"unreclaimed\": " << result.unreclaimed << ",\n"
+                  << "  \"throughput_per_s\": " << static_cast<double>(result.reads) / result.seconds << "\n"
+                  << "}\n";
+        return result.mismatches == 0 && result.inconsistent == 0 && result.unreclaimed == 0 ? 0 : 2;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        const auto index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1));
+        return sorted[index];
+    }
+}
+
+
+// Usage: oop2_ex03_loadgen [--seed s] [--ops n] [--max-inputs n] [--size n] [--requests n]
+//                          [--rate per_second] [--driver api|calculator|registry] [--threads n]
+int main(int argc, char* argv[])
+{
+    using Clock = std::chrono::steady_clock;
+
+    try
+    {
+        const auto options = parseOptions(argc, argv);
+        auto generator = Generator(options.seed);
+        const auto workload = generator.makeWorkload(options.operations, options.maxInputs);
+        if (options.registry)
+            return runRegistryDriver(options, workload, generator);
+        const auto evaluators = makeEvaluators();
+        const auto& driver = evaluators.front();
+
+        auto latenciesUs = std::vector<double>();
+        int mismatches = 0;
+        int outOfRange = 0;
+        const auto start = Clock::now();
+
+        for (int request = 0; request < options.requests; ++request)
+        {
+            const int node = generator.pickNode(workload);
+            const auto input = generator.makeInputs(workload.nodes[static_cast<std::size_t>(node)].inputCount, options.size);
+
+            // Open loop: latency counts from the scheduled start, so a slow request delays the next ones
+            auto scheduled = Clock::now();
+            if (options.rate > 0)
+            {
+                scheduled = start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(request / options.rate));
+                std::this_thread::sleep_until(scheduled);
+            }
+
+            const auto outcome = options.calculator ? evalThroughCalculator(workload, node, input)
+                                                    : driver.run(workload, node, input);
+            latenciesUs.push_back(std::chrono::duration<double, std::micro>(Clock::now() - scheduled).count());
+
+            const auto expected = referenceEval(workload, node, input);
+            if (!expected)
+                ++outOfRange;
+
+            auto checks = std::vector<std::pair<std::string, Outcome>>{ { options.calculator ? "calculator" : driver.name, outcome } };
+            for (const auto& evaluator : evaluators)
+            {
+                if (options.calculator || &evaluator != &driver)
+                    checks.emplace_back(evaluator.name, evaluator.run(workload, node, input));
+            }
+            for (const auto& [name, result] : checks)
+            {
+                if (sameOutcome(expected, result))
+                    continue;
+                if (++mismatches <= 10)
+                {
+                    std::cerr << "MISMATCH seed " << options.seed << " request " << request
+                              << " node " << node << " evaluator " << name << ": ";
+                    workload.operations[static_cast<std::size_t>(node)]->print(std::cerr, true);
+                    std::cerr << '\n';
+                }
+            }
+        }
+
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::ranges::sort(latenciesUs);
+        std::cout << "{\n"
+                  << "  \"seed\": " << options.seed << ",\n"
+                  << "  \"driver\": \"" << (options.calculator ? "calculator" : "api") << "\",\n"
+                  << "  \"operations\": " << workload.nodes.size() << ",\n"
+                  << "  \"requests\": " << options.requests << ",\n"
+                  << "  \"out_of_range\": " << outOfRange << ",\n"
+                  << "  \"mismatches\": " << mismatches << ",\n"
+                  << "  \"throughput_per_s\": " << options.requests / seconds << ",\n"
+                  << "  \"latency_us\": { \"p50\": " << percentile(latenciesUs, 0.50)
+                  << ", \"p90\": " << percentile(latenciesUs, 0.90)
+                  << ", \"p99\": " << percentile(latenciesUs, 0.99)
+                  << ", \"p999\": " << percentile(latenciesUs, 0.999)
+                  << ", \"max\": " << latenciesUs.back() << " }\n"
+                  << "}\n";
+        return mismatches == 0 ? 0 : 2;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+}
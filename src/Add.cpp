@@ -1,21 +1,68 @@
 #include "Add.h"
+#include "Profiler.h"
 
+#include <algorithm>
 #include <iostream>
 
 
-Operation::T Add::compute(const std::vector<T>& input) const
+template <typename M>
+typename BasicAdd<M>::T BasicAdd<M>::compute(const std::vector<T>& input) const
 {
-    const auto a = first()->compute(input);
-    auto firstCount = first()->inputCount();
+    PROFILE_OPERATION(*this);
+    const auto a = this->first()->compute(input);
+    auto firstCount = this->first()->inputCount();
 	//remove the firstCount elements from the input vector, and put in a new vector
 	std::vector input2(input.begin() + firstCount, input.end());
-    const auto b = second()->compute(input2);
+    const auto b = this->second()->compute(input2);
 
     return a + b;
 }
 
 
-void Add::printSymbol(std::ostream& ostr) const
+template <typename M>
+typename BasicAdd<M>::S BasicAdd<M>::computeStructured(const std::vector<S>& input) const
+{
+    PROFILE_OPERATION(*this);
+    const auto a = this->first()->computeStructured(input);
+    const auto firstCount = this->first()->inputCount();
+    const auto b = this->second()->computeStructured(std::vector<S>(input.begin() + firstCount, input.end()));
+
+    return a + b;
+}
+
+
+template <typename M>
+std::optional<EvalFault> BasicAdd<M>::tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+    PROFILE_OPERATION(*this);
+    const auto firstCount = static_cast<std::size_t>(this->first()->inputCount());
+    if (auto fault = this->first()->tryComputeInto(input.first(firstCount), out, scratch))
+        return fault;
+
+    const auto mark = ScratchMark(scratch);
+    const auto b = Ref(scratch.allocate<typename M::value_type>(out.count()), out.size());
+    if (auto fault = this->second()->tryComputeInto(input.subspan(firstCount), b, scratch))
+        return fault;
+    if (const auto fault = detail::tryAddValues<typename M::value_type, typename M::policy_type>(out.data(), b.data(), out.count()))
+        return makeFault(*this, out.size(), *fault);
+    return std::nullopt;
+}
+
+
+template <typename M>
+std::size_t BasicAdd<M>::scratchBytes(int size) const
+{
+    // The first result goes straight to out, the second needs a matrix of its own while it runs
+    const auto matrix = Scratch::bytesFor<typename M::value_type>(static_cast<std::size_t>(size) * static_cast<std::size_t>(size));
+    return std::max(this->first()->scratchBytes(size), matrix + this->second()->scratchBytes(size));
+}
+
+
+template <typename M>
+void BasicAdd<M>::printSymbol(std::ostream& ostr) const
 {
     ostr << '+';
 }
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicAdd);
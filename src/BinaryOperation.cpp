@@ -3,13 +3,15 @@
 #include <iostream>
 
 
-BinaryOperation::BinaryOperation(const std::shared_ptr<Operation>& first, const std::shared_ptr<Operation>& second)
-    : m_first(first), m_second(second)
+template <typename M>
+BasicBinaryOperation<M>::BasicBinaryOperation(const OperationPtr& first, const OperationPtr& second)
+    : m_first(first), m_second(second), m_inputCount(first->inputCount() + second->inputCount())
 {
 }
 
 
-void BinaryOperation::print(std::ostream& ostr, bool first_print ) const
+template <typename M>
+void BasicBinaryOperation<M>::print(std::ostream& ostr, bool first_print ) const
 {
     if (!first_print)
         ostr << '(';
@@ -20,4 +22,7 @@ void BinaryOperation::print(std::ostream& ostr, bool first_print ) const
     second()->print(ostr);
     if (!first_print)
         ostr << ')';
-}
\ No newline at end of file
+}
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicBinaryOperation);
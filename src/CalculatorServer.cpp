@@ -0,0 +1,616 @@
+#include "CalculatorServer.h"
+#include "Protocol.h"
+#include "Add.h"
+#include "Comp.h"
+#include "Scalar.h"
+#include "Sub.h"
+#include "MemoryFootprint.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+
+void CalculatorServer::LatencyStats::record(std::int64_t ns, bool failed)
+{
+    ns = std::max<std::int64_t>(ns, 1);
+    ++m_buckets[std::bit_width(static_cast<std::uint64_t>(ns)) - 1];
+    ++m_count;
+    m_errors += failed;
+    m_totalNs += ns;
+    m_maxNs = std::max(m_maxNs, ns);
+}
+
+
+std::int64_t CalculatorServer::LatencyStats::percentile(double fraction) const
+{
+    const auto wanted = static_cast<std::int64_t>(fraction * static_cast<double>(m_count));
+    std::int64_t seen = 0;
+    for (std::size_t i = 0; i < m_buckets.size(); ++i)
+    {
+        seen += m_buckets[i];
+        if (seen > wanted)
+            return std::min(m_maxNs, (std::int64_t{ 2 } << i) - 1);
+    }
+    return m_maxNs;
+}
+
+
+void CalculatorServer::LatencyStats::print(std::ostream& ostr) const
+{
+    const auto us = [](std::int64_t ns) { return static_cast<double>(ns) / 1e3; };
+    ostr << "requests " << m_count << " (" << m_errors << " errors)\n";
+    if (m_count == 0)
+        return;
+    ostr << "mean " << us(m_totalNs / m_count) << " us, p50 <= " << us(percentile(0.5))
+         << " us, p99 <= " << us(percentile(0.99)) << " us, max " << us(m_maxNs) << " us\n";
+}
+
+
+std::string CalculatorServer::handle(const std::string& request)
+{
+    const auto begin = std::chrono::steady_clock::now();
+    auto in = std::istringstream(request);
+    auto out = std::ostringstream();
+    bool failed = false;
+    try
+    {
+        execute(in, out);
+        auto rest = std::string();
+        if (in >> rest)
+            throw std::invalid_argument("to meny argument for the action");
+        out.str("ok\n" + out.str());
+    }
+    catch (const std::exception& e)
+    {
+        failed = true;
+        out.str(std::string("error\n") + e.what() + '\n');
+    }
+    const auto end = std::chrono::steady_clock::now();
+    m_stats.record(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count(), failed);
+    return out.str();
+}
+
+
+void CalculatorServer::execute(std::istream& in, std::ostream& out)
+{
+    auto command = std::string();
+    if (!(in >> command))
+        throw std::invalid_argument("Empty request");
+
+    if (command == "eval")
+        evalRequest(in, out);
+    else if (command == "list")
+        listRequest(out);
+    else if (command == "add" || command == "sub" || command == "comp")
+    {
+        const auto first = m_operations.at(readIndex(in));
+        const auto second = m_operations.at(readIndex(in));
+        if (command == "add")
+            out << m_operations.add(std::make_shared<Add>(first, second)) << '\n';
+        else if (command == "sub")
+            out << m_operations.add(std::make_shared<Sub>(first, second)) << '\n';
+        else
+            out << m_operations.add(std::make_shared<Comp>(first, second)) << '\n';
+    }
+    else if (command == "scal")
+    {
+        int scalar = 0;
+        if (!(in >> scalar))
+            throw std::invalid_argument("Invalid input: expected an integer for scalar");
+        out << m_operations.add(std::make_shared<Scalar>(scalar)) << '\n';
+    }
+    else if (command == "del")
+        m_operations.erase(readIndex(in));
+    else if (command == "limit")
+    {
+        long long bytes = 0;
+        if (!(in >> bytes) || bytes < 0)
+            throw std::invalid_argument("Invalid input: expected a number of bytes (0 for no limit)");
+        m_evalLimit = static_cast<std::size_t>(bytes);
+    }
+    else if (command == "stats")
+    {
+        m_stats.print(out);
+        out << "connections " << m_connections.size() << " open, " << m_acceptedConnections << " accepted, "
+            << m_droppedConnections << " dropped\n";
+    }
+    else if (command == "shutdown")
+        stop();
+    else
+        throw std::invalid_argument("Unknown command: " + command);
+}
+
+
+void CalculatorServer::evalRequest(std::istream& in, std::ostream& out) const
+{
+    const auto operation = m_operations.at(readIndex(in));
+    int size = 0;
+    in >> size;
+    if (in.fail() || size <= 0 || size > 5)
+        throw std::out_of_range("Invalid input: plase enter size between 1 - 5");
+    MemoryFootprint::checkEvalLimit(*operation, size, m_evalLimit);
+
+    auto inputs = std::vector<Operation::T>(static_cast<std::size_t>(operation->inputCount()), Operation::T(size));
+    for (auto& input : inputs)
+        in >> input;
+    // Through computeInto, like the calculator's eval, so the limit bounds what it holds
+    const auto views = std::vector<Operation::ConstRef>(inputs.begin(), inputs.end());
+    auto result = Operation::T(size);
+    auto scratch = Scratch(operation->scratchBytes(size));
+    operation->computeInto(views, result, scratch);
+    out << result;
+}
+
+
+void CalculatorServer::listRequest(std::ostream& out) const
+{
+    const auto operations = m_operations.snapshot();
+    for (std::size_t i = 0; i < operations->size(); ++i)
+    {
+        out << i << ". ";
+        (*operations)[i]->print(out, true);
+        out << '\n';
+    }
+}
+
+
+std::size_t CalculatorServer::readIndex(std::istream& in) const
+{
+    long long index = 0;
+    if (!(in >> index))
+        throw std::invalid_argument("Invalid input: expected an integer for operation index");
+    if (index < 0 || index >= static_cast<long long>(m_operations.size()))
+        throw std::out_of_range("Operation #" + std::to_string(index) + " doesn't exist");
+    return static_cast<std::size_t>(index);
+}
+
+
+#ifdef __linux__
+
+namespace
+{
+    [[noreturn]] void throwSystemError(const std::string& what)
+    {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    sockaddr_un socketAddress(const std::string& path)
+    {
+        auto address = sockaddr_un{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument("Socket path is too long: " + path);
+        std::copy(path.begin(), path.end(), address.sun_path);
+        return address;
+    }
+
+    // Adds fd to the epoll set or changes the events it waits for
+    bool watch(int epollFd, int operation, int fd, std::uint32_t events)
+    {
+        auto event = epoll_event{};
+        event.events = events;
+        event.data.fd = fd;
+        return ::epoll_ctl(epollFd, operation, fd, &event) == 0;
+    }
+
+    // A socket file left by a server that did not exit cleanly would make bind fail.
+    // Only such a stale socket is removed: another kind of file, or a socket that a
+    // server still answers on, is refused.
+    void removeStaleSocket(const std::string& path, const sockaddr_un& address)
+    {
+        struct stat status{};
+        if (::lstat(path.c_str(), &status) < 0)
+        {
+            if (errno == ENOENT)
+                return;
+            throwSystemError("lstat " + path);
+        }
+        if (!S_ISSOCK(status.st_mode))
+            throw std::runtime_error(path + " exists and is not a socket");
+
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (probe < 0)
+            throwSystemError("socket");
+        // Nobody listens on a stale socket, any other outcome means it may still be in use
+        const bool stale = ::connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0
+            && errno == ECONNREFUSED;
+        ::close(probe);
+        if (!stale)
+            throw std::runtime_error("A server is already listening on " + path);
+        if (::unlink(path.c_str()) < 0 && errno != ENOENT)
+            throwSystemError("unlink " + path);
+    }
+}
+
+
+CalculatorServer::CalculatorServer(std::string socketPath, OperationList operations)
+    : m_socketPath(std::move(socketPath)), m_operations(std::move(operations))
+{
+    m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+        throwSystemError("eventfd");
+    m_reserveFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+
+CalculatorServer::~CalculatorServer()
+{
+    for (const auto& [fd, connection] : m_connections)
+        ::close(fd);
+    if (m_listenFd >= 0)
+    {
+        ::close(m_listenFd);
+        ::unlink(m_socketPath.c_str());
+    }
+    if (m_epollFd >= 0)
+        ::close(m_epollFd);
+    if (m_reserveFd >= 0)
+        ::close(m_reserveFd);
+    ::close(m_wakeFd);
+}
+
+
+void CalculatorServer::stop()
+{
+    m_running = false;
+    const std::uint64_t one = 1;
+    [[maybe_unused]] const auto written = ::write(m_wakeFd, &one, sizeof(one));
+}
+
+
+void CalculatorServer::run()
+{
+    const auto address = socketAddress(m_socketPath);
+    removeStaleSocket(m_socketPath, address);
+    const int listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+        throwSystemError("socket");
+    if (::bind(listenFd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        const int error = errno;
+        ::close(listenFd);
+        errno = error;
+        throwSystemError("bind " + m_socketPath);
+    }
+    // Owned from here on, the destructor removes the socket file with it
+    m_listenFd = listenFd;
+    if (::listen(m_listenFd, SOMAXCONN) < 0)
+        throwSystemError("listen");
+
+    m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0)
+        throwSystemError("epoll_create1");
+    for (const int fd : { m_listenFd, m_wakeFd })
+    {
+        if (!watch(m_epollFd, EPOLL_CTL_ADD, fd, EPOLLIN))
+            throwSystemError("epoll_ctl");
+    }
+
+    m_running = true;
+    auto events = std::array<epoll_event, 64>();
+    while (m_running)
+    {
+        const int ready = ::epoll_wait(m_epollFd, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throwSystemError("epoll_wait");
+        }
+
+        for (const auto& event : std::span(events).first(static_cast<std::size_t>(ready)))
+        {
+            const int fd = event.data.fd;
+            if (fd == m_listenFd)
+            {
+                acceptClients();
+                continue;
+            }
+            if (fd == m_wakeFd)
+                continue;
+
+            // The connection may have been closed by an earlier event of this round
+            const auto found = m_connections.find(fd);
+            if (found == m_connections.end())
+                continue;
+            // Read first, a request may arrive together with the hang up
+            if (event.events & EPOLLIN)
+                readClient(fd, found->second);
+            else if (event.events & (EPOLLERR | EPOLLHUP))
+                closeClient(fd);
+            else if (event.events & EPOLLOUT)
+            {
+                // Requests left waiting while the client was paused are answered once it drained
+                const bool paused = found->second.paused;
+                if (writeClient(fd, found->second) && paused && !found->second.paused)
+                    answerClient(fd, found->second);
+            }
+        }
+    }
+}
+
+
+void CalculatorServer::acceptClients()
+{
+    while (true)
+    {
+        const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            if (errno == EMFILE || errno == ENFILE)
+            {
+                if (shedClient())
+                    continue;
+                return;
+            }
+            // Left pending, the listening socket stays readable and the loop retries it
+            std::cerr << "accept: " << std::strerror(errno) << '\n';
+            return;
+        }
+
+        // A client the loop cannot watch would never be served, it is dropped at once
+        if (!watch(m_epollFd, EPOLL_CTL_ADD, fd, EPOLLIN))
+        {
+            ::close(fd);
+            continue;
+        }
+        m_connections.emplace(fd, Connection());
+        ++m_acceptedConnections;
+    }
+}
+
+
+bool CalculatorServer::shedClient()
+{
+    // Out of descriptors, a pending connection would keep the listening socket readable
+    // and spin the loop. The reserve descriptor is given up to accept it and hang up at once.
+    if (m_reserveFd < 0)
+    {
+        std::cerr << "accept: " << std::strerror(errno) << '\n';
+        return false;
+    }
+    ::close(m_reserveFd);
+    const int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0)
+        ::close(fd);
+    m_reserveFd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    // Nothing is pending any more
+    if (fd < 0)
+        return false;
+    std::cerr << "Out of file descriptors, dropped a connection\n";
+    ++m_droppedConnections;
+    return true;
+}
+
+
+void CalculatorServer::readClient(int fd, Connection& connection)
+{
+    char buffer[4096];
+    // Enough for the largest frame, the rest stays in the socket until it is answered
+    while (connection.input.size() < protocol::headerSize + protocol::maxPayload)
+    {
+        const auto count = ::read(fd, buffer, sizeof(buffer));
+        if (count > 0)
+        {
+            connection.input.append(buffer, static_cast<std::size_t>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        // End of file or error
+        closeClient(fd);
+        return;
+    }
+    answerClient(fd, connection);
+}
+
+
+void CalculatorServer::answerClient(int fd, Connection& connection)
+{
+    // Answer every complete frame, a partial one waits for the next read
+    std::size_t offset = 0;
+    while (const auto length = protocol::payloadLength(connection.input.data() + offset, connection.input.size() - offset))
+    {
+        if (*length > protocol::maxPayload)
+        {
+            closeClient(fd);
+            return;
+        }
+        if (connection.input.size() - offset < protocol::headerSize + *length)
+            break;
+        const auto request = connection.input.substr(offset + protocol::headerSize, *length);
+        offset += protocol::headerSize + *length;
+        connection.output += protocol::frame(handle(request));
+
+        // Send as the responses pile up, a client that doesn't read them gets no more
+        // until the pending ones drain
+        if (connection.output.size() - connection.written > protocol::maxPayload)
+        {
+            connection.input.erase(0, offset);
+            offset = 0;
+            if (!writeClient(fd, connection) || connection.paused)
+                return;
+        }
+    }
+    connection.input.erase(0, offset);
+    writeClient(fd, connection);
+}
+
+
+bool CalculatorServer::writeClient(int fd, Connection& connection)
+{
+    while (connection.written < connection.output.size())
+    {
+        const auto count = ::send(fd, connection.output.data() + connection.written,
+            connection.output.size() - connection.written, MSG_NOSIGNAL);
+        if (count >= 0)
+        {
+            connection.written += static_cast<std::size_t>(count);
+            continue;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            closeClient(fd);
+            return false;
+        }
+        break;
+    }
+
+    // Drop what was sent once it outweighs what is left, so a client that keeps reading
+    // slowly doesn't grow the buffer
+    const auto pending = connection.output.size() - connection.written;
+    if (connection.written >= pending)
+    {
+        connection.output.erase(0, connection.written);
+        connection.written = 0;
+    }
+    // Only wait for the socket to become writable while a response is stuck, and stop
+    // reading requests while too much of them is stuck
+    const bool writing = pending != 0;
+    const bool paused = pending > protocol::maxPayload;
+    if (writing != connection.writing || paused != connection.paused)
+    {
+        if (!watch(m_epollFd, EPOLL_CTL_MOD, fd, (paused ? 0u : EPOLLIN) | (writing ? EPOLLOUT : 0u)))
+        {
+            closeClient(fd);
+            return false;
+        }
+        connection.writing = writing;
+        connection.paused = paused;
+    }
+    return true;
+}
+
+
+void CalculatorServer::closeClient(int fd)
+{
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    m_connections.erase(fd);
+}
+
+
+int runCalculatorClient(const std::string& socketPath, std::istream& in, std::ostream& out)
+{
+    const auto address = socketAddress(socketPath);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        throwSystemError("socket");
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        ::close(fd);
+        throwSystemError("connect " + socketPath);
+    }
+
+    const auto sendAll = [fd](const std::string& data)
+    {
+        for (std::size_t sent = 0; sent < data.size();)
+        {
+            const auto count = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (count < 0 && errno != EINTR)
+                return false;
+            sent += static_cast<std::size_t>(std::max<ssize_t>(count, 0));
+        }
+        return true;
+    };
+    const auto receiveAll = [fd](char* data, std::size_t size)
+    {
+        for (std::size_t received = 0; received < size;)
+        {
+            const auto count = ::recv(fd, data + received, size - received, 0);
+            if (count == 0 || (count < 0 && errno != EINTR))
+                return false;
+            received += static_cast<std::size_t>(std::max<ssize_t>(count, 0));
+        }
+        return true;
+    };
+
+    int failed = 0;
+    auto line = std::string();
+    while (std::getline(in, line))
+    {
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+
+        char header[protocol::headerSize];
+        if (!sendAll(protocol::frame(line)) || !receiveAll(header, sizeof(header)))
+        {
+            ::close(fd);
+            throw std::runtime_error("Connection to the server was lost");
+        }
+        auto response = std::string(*protocol::payloadLength(header, sizeof(header)), '\0');
+        if (!receiveAll(response.data(), response.size()))
+        {
+            ::close(fd);
+            throw std::runtime_error("Connection to the server was lost");
+        }
+
+        const auto status = response.substr(0, response.find('\n') + 1);
+        const auto body = response.substr(status.size());
+        if (status == "ok\n")
+            out << body;
+        else
+        {
+            ++failed;
+            out << "Error: " << body;
+        }
+        out << std::flush;
+    }
+    ::close(fd);
+    return failed;
+}
+
+#else
+
+CalculatorServer::CalculatorServer(std::string socketPath, OperationList operations)
+    : m_socketPath(std::move(socketPath)), m_operations(std::move(operations))
+{
+}
+
+
+CalculatorServer::~CalculatorServer() = default;
+
+
+void CalculatorServer::stop()
+{
+    m_running = false;
+}
+
+
+void CalculatorServer::run()
+{
+    throw std::runtime_error("Server mode is only available on Linux");
+}
+
+
+int runCalculatorClient(const std::string&, std::istream&, std::ostream&)
+{
+    throw std::runtime_error("Server mode is only available on Linux");
+}
+
+#endif
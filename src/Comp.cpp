@@ -1,25 +1,131 @@
 #include "Comp.h"
+#include "Scalar.h"
+#include "Profiler.h"
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
 
 
-int Comp::inputCount() const
+template <typename M>
+BasicComp<M>::BasicComp(const OperationPtr& arg1, const OperationPtr& arg2)
+ : BasicBinaryOperation<M>(arg1, arg2)
 {
-    return first()->inputCount() + second()->inputCount() - 1;
+    // Nested compositions already hold their normal form, which shares their scalars,
+    // so building a chain one stage at a time stays linear
+    auto first = linearMapOf(*arg1);
+    if (!first)
+        return;
+    const auto second = linearMapOf(*arg2);
+    if (!second)
+        return;
+    first->append(*second);
+    m_linear = std::move(first);
 }
 
 
-Operation::T Comp::compute(const std::vector<T>& input) const
+template <typename M>
+std::optional<typename BasicComp<M>::Linear> BasicComp<M>::linearMapOf(const BasicOperation<M>& operation)
 {
-    const auto resultOfFirst = first()->compute(input);
-    auto firstCount = first()->inputCount();
+    auto map = Linear();
+    switch (operation.kind())
+    {
+    case OperationBase::Kind::Identity: return map;
+    case OperationBase::Kind::Transpose: map.appendTranspose(); return map;
+    case OperationBase::Kind::Scalar: map.appendScale(static_cast<const BasicScalar<M>&>(operation).scalar()); return map;
+    case OperationBase::Kind::Comp: return static_cast<const BasicComp&>(operation).m_linear;
+    default: return std::nullopt;
+    }
+}
+
+
+template <typename M>
+int BasicComp<M>::inputCount() const
+{
+    // The result of the first operation is the first input of the second one
+    return BasicBinaryOperation<M>::inputCount() - 1;
+}
+
+
+template <typename M>
+typename BasicComp<M>::T BasicComp<M>::compute(const std::vector<T>& input) const
+{
+    PROFILE_OPERATION(*this);
+    if (m_linear)
+    {
+        // One pass over the input replaces the whole chain of stages
+        auto result = T(input.front().size());
+        m_linear->apply(input.front().data(), result.data(), result.size());
+        return result;
+    }
+    const auto resultOfFirst = this->first()->compute(input);
+    auto firstCount = this->first()->inputCount();
     std::vector input2(input.begin() + firstCount, input.end());
 	input2.insert(input2.begin(), resultOfFirst);
-    return second()->compute(input2);
+    return this->second()->compute(input2);
+}
+
+
+template <typename M>
+typename BasicComp<M>::S BasicComp<M>::computeStructured(const std::vector<S>& input) const
+{
+    PROFILE_OPERATION(*this);
+    const auto firstCount = this->first()->inputCount();
+    auto input2 = std::vector<S>{ this->first()->computeStructured(input) };
+    input2.insert(input2.end(), input.begin() + firstCount, input.end());
+    return this->second()->computeStructured(input2);
+}
+
+
+template <typename M>
+std::optional<EvalFault> BasicComp<M>::tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+    PROFILE_OPERATION(*this);
+    if (m_linear)
+    {
+        if (const auto fault = m_linear->tryApply(input.front().data(), out.data(), out.size(), scratch))
+            return makeFault(*this, out.size(), *fault);
+        return std::nullopt;
+    }
+    const auto firstCount = static_cast<std::size_t>(this->first()->inputCount());
+    const auto secondCount = input.size() - firstCount + 1;
+
+    const auto mark = ScratchMark(scratch);
+    const auto resultOfFirst = Ref(scratch.allocate<typename M::value_type>(out.count()), out.size());
+    auto* input2 = scratch.allocate<ConstRef>(secondCount);
+    if (auto fault = this->first()->tryComputeInto(input.first(firstCount), resultOfFirst, scratch))
+        return fault;
+
+    std::construct_at(input2, resultOfFirst);
+    std::uninitialized_copy(input.begin() + static_cast<std::ptrdiff_t>(firstCount), input.end(), input2 + 1);
+    return this->second()->tryComputeInto(std::span<const ConstRef>(input2, secondCount), out, scratch);
+}
+
+
+template <typename M>
+std::size_t BasicComp<M>::scratchBytes(int size) const
+{
+    if (m_linear)
+        return m_linear->scratchBytes();
+    // The first result and the input list of the second operation live while both run
+    const auto matrix = Scratch::bytesFor<typename M::value_type>(static_cast<std::size_t>(size) * static_cast<std::size_t>(size));
+    const auto views = Scratch::bytesFor<ConstRef>(static_cast<std::size_t>(this->second()->inputCount()));
+    return matrix + views + std::max(this->first()->scratchBytes(size), this->second()->scratchBytes(size));
 }
 
 
-void Comp::printSymbol(std::ostream& ostr) const
+template <typename M>
+std::size_t BasicComp<M>::objectBytes() const
+{
+    return sizeof(*this) + (m_linear ? m_linear->heapBytes() : 0);
+}
+
+
+template <typename M>
+void BasicComp<M>::printSymbol(std::ostream& ostr) const
 {
     ostr << " -> ";
 }
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicComp);
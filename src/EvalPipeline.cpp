@@ -0,0 +1,256 @@
+#include "EvalPipeline.h"
+#include "BoundedQueue.h"
+#include "Topology.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::int64_t elapsedNs(Clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+}
+
+
+EvalPipeline::EvalPipeline(const Operation& operation, int size, Options options)
+    : m_operation(operation), m_size(size), m_options(options)
+{
+    if (m_options.workers <= 0)
+        m_options.workers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+}
+
+
+EvalPipeline::Stats EvalPipeline::run(std::istream& in, std::ostream& out, int count)
+{
+    auto stats = Stats();
+    stats.workers = m_options.workers;
+    stats.batchSize = batchSize(count);
+    const auto start = Clock::now();
+
+    auto jobs = BoundedQueue<Job>(m_options.queueCapacity);
+    auto results = BoundedQueue<Result>(m_options.queueCapacity);
+    std::atomic<int> parsed = 0;
+    std::atomic<bool> parserDone = false;
+    std::atomic<std::int64_t> workerParseNs = 0;
+    std::atomic<std::int64_t> computeNs = 0;
+    std::atomic<int> pinned = 0;
+
+    auto parser = std::jthread([&]
+    {
+        auto job = Job{ 0, {} };
+        const auto flush = [&]
+        {
+            const auto sets = static_cast<int>(job.sets.size());
+            jobs.push(std::exchange(job, Job{ job.index + sets, {} }));
+            parsed.fetch_add(sets, std::memory_order_release);
+        };
+        for (int index = 0; index < count && (in >> std::ws).peek() != std::istream::traits_type::eof(); ++index)
+        {
+            const auto parseStart = Clock::now();
+            job.sets.push_back(m_options.placement ? readText(in) : parse(in));
+            stats.parseNs += elapsedNs(parseStart);
+            if (static_cast<int>(job.sets.size()) == stats.batchSize)
+                flush();
+        }
+        if (!job.sets.empty())
+            flush();
+        parserDone.store(true, std::memory_order_release);
+        for (int i = 0; i < m_options.workers; ++i)
+            jobs.push(Job{ -1, {} });
+    });
+
+    auto workers = std::vector<std::jthread>();
+    for (int i = 0; i < m_options.workers; ++i)
+    {
+        workers.emplace_back([&, worker = i]
+        {
+            if (m_options.placement && Topology::pinCurrentThread(Topology::current().cpuForWorker(worker)))
+                pinned.fetch_add(1);
+            // Allocated after pinning, so the pages come from this worker's node
+            auto scratch = Scratch(m_operation.scratchBytes(m_size));
+            auto views = std::vector<Operation::ConstRef>();
+            views.reserve(static_cast<std::size_t>(m_operation.inputCount()));
+
+            std::int64_t parsingNs = 0;
+            std::int64_t busyNs = 0;
+            for (auto job = jobs.pop(); job.index >= 0; job = jobs.pop())
+            {
+                for (std::size_t k = 0; k < job.sets.size(); ++k)
+                {
+                    auto& set = job.sets[k];
+                    if (!set.text.empty())
+                    {
+                        const auto parseStart = Clock::now();
+                        auto text = std::istringstream(std::move(set.text));
+                        set = parse(text);
+                        parsingNs += elapsedNs(parseStart);
+                    }
+                    const auto computeStart = Clock::now();
+                    auto result = evaluate(job.index + static_cast<int>(k), std::move(set), scratch, views);
+                    busyNs += elapsedNs(computeStart);
+                    results.push(std::move(result));
+                }
+            }
+            workerParseNs.fetch_add(parsingNs);
+            computeNs.fetch_add(busyNs);
+        });
+    }
+
+    // The workers finish out of order, so results wait here until their turn
+    auto pending = std::map<int, Result>();
+    int next = 0;
+    auto result = Result();
+    for (int attempt = 0;; )
+    {
+        if (parserDone.load(std::memory_order_acquire) && next == parsed.load(std::memory_order_acquire))
+            break;
+        if (!results.tryPop(result))
+        {
+            BoundedQueue<Result>::backoff(attempt++);
+            continue;
+        }
+        attempt = 0;
+        const int index = result.index;
+        pending.emplace(index, std::move(result));
+        for (auto it = pending.find(next); it != pending.end(); it = pending.find(next))
+        {
+            const auto formatStart = Clock::now();
+            format(out, it->second);
+            stats.formatNs += elapsedNs(formatStart);
+            stats.errors += it->second.output ? 0 : 1;
+            pending.erase(it);
+            ++next;
+        }
+    }
+
+    parser.join();
+    workers.clear();
+    stats.sets = next;
+    stats.parseNs += workerParseNs.load();
+    stats.computeNs = computeNs.load();
+    stats.pinned = pinned.load();
+    stats.totalNs = elapsedNs(start);
+    return stats;
+}
+
+
+int EvalPipeline::batchSize(int count) const
+{
+    if (!m_options.placement)
+        return 1;
+    // Half of L2 holds the batch (inputs and results) and the scratch, the other half
+    // is left to the code and the queues; every evaluator still gets several batches
+    const auto matrixBytes = static_cast<std::size_t>(m_size) * static_cast<std::size_t>(m_size) * sizeof(Operation::T::value_type);
+    const auto setBytes = (static_cast<std::size_t>(m_operation.inputCount()) + 1) * (matrixBytes + sizeof(Operation::T));
+    const auto room = Topology::current().l2Bytes() / 2 - std::min(Topology::current().l2Bytes() / 2, m_operation.scratchBytes(m_size));
+    const auto fitting = static_cast<int>(std::min<std::size_t>(room / setBytes, std::numeric_limits<int>::max()));
+    return std::max(1, std::min(fitting, count / (m_options.workers * 8)));
+}
+
+
+EvalPipeline::Set EvalPipeline::parse(std::istream& in) const
+{
+    auto set = Set();
+    for (int i = 0; i < m_operation.inputCount(); ++i)
+    {
+        auto matrix = Operation::T(m_size);
+        try
+        {
+            in >> matrix;
+            if (in.peek() != '\n' && in.peek() != std::istream::traits_type::eof())
+            {
+                in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                throw std::invalid_argument("to many items for the matrix");
+            }
+        }
+        catch (const std::exception& e)
+        {
+            // Keep reading the rest of the set so the next set starts at the right line
+            if (set.error.empty())
+                set.error = e.what();
+        }
+        set.input.push_back(std::move(matrix));
+    }
+    return set;
+}
+
+
+EvalPipeline::Set EvalPipeline::readText(std::istream& in) const
+{
+    // The tokens parse() would read: every matrix is size * size of them, however its rows
+    // are spread over the lines. What follows on its last line is kept for parse() to
+    // reject, and every matrix becomes one line of the text.
+    const auto tokens = static_cast<std::size_t>(m_size) * static_cast<std::size_t>(m_size);
+    auto set = Set();
+    auto token = std::string();
+    auto rest = std::string();
+    for (int i = 0; i < m_operation.inputCount(); ++i)
+    {
+        for (std::size_t k = 0; k < tokens && in >> token; ++k)
+        {
+            if (k != 0)
+                set.text += ' ';
+            set.text += token;
+        }
+        std::getline(in, rest);
+        set.text += rest;
+        set.text += '\n';
+        if (i == 0)
+            set.text.reserve(set.text.size() * static_cast<std::size_t>(m_operation.inputCount()));
+    }
+    return set;
+}
+
+
+EvalPipeline::Result EvalPipeline::evaluate(int index, Set set, Scratch& scratch, std::vector<Operation::ConstRef>& views) const
+{
+    auto result = Result();
+    result.index = index;
+    result.error = std::move(set.error);
+    if (result.error.empty())
+    {
+        try
+        {
+            views.assign(set.input.begin(), set.input.end());
+            // Sets that overflow are common in adversarial batches, so range errors come
+            // back as a status instead of unwinding
+            auto output = Operation::T(m_size);
+            if (m_operation.tryComputeInto(views, output, scratch))
+                result.error = "Matrix value is out of range";
+            else
+                result.output = std::move(output);
+        }
+        catch (const std::exception& e)
+        {
+            result.error = e.what();
+        }
+    }
+    result.input = std::move(set.input);
+    return result;
+}
+
+
+void EvalPipeline::format(std::ostream& out, const Result& result) const
+{
+    if (!result.output)
+    {
+        out << "\nError in set " << result.index + 1 << ": " << result.error << '\n';
+        return;
+    }
+    out << '\n';
+    m_operation.print(out, result.input);
+    out << " = \n" << *result.output;
+}
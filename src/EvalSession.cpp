@@ -0,0 +1,217 @@
+#include "EvalSession.h"
+#include "Scalar.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+
+namespace
+{
+    bool sameValues(const Operation::T& lhs, const Operation::T& rhs)
+    {
+        const auto count = static_cast<std::size_t>(lhs.size()) * static_cast<std::size_t>(lhs.size());
+        return lhs.size() == rhs.size() && std::equal(lhs.data(), lhs.data() + count, rhs.data());
+    }
+}
+
+
+EvalSession::EvalSession(std::shared_ptr<const Operation> operation, std::vector<Operation::T> inputs)
+    : m_operation(std::move(operation)), m_inputs(std::move(inputs)), m_inputUsers(m_inputs.size())
+{
+    if (static_cast<int>(m_inputs.size()) != m_operation->inputCount())
+        throw std::invalid_argument("Expected " + std::to_string(m_operation->inputCount()) + " input matrices");
+    if (std::ranges::any_of(m_inputs, [&](const auto& input) { return input.size() != m_inputs.front().size(); }))
+        throw std::invalid_argument("All input matrices must have the same size");
+
+    auto arguments = std::vector<Source>();
+    for (int slot = 0; slot < inputCount(); ++slot)
+        arguments.push_back({ true, slot });
+    m_root = flatten(*m_operation, std::move(arguments));
+}
+
+
+int EvalSession::flatten(const Operation& operation, std::vector<Source> arguments)
+{
+    // Iterative post-order walk, the chains can be far deeper than the call stack allows.
+    // A frame is revisited once per finished child; returned holds that child's node.
+    struct Frame
+    {
+        const Operation* operation = nullptr;
+        std::vector<Source> arguments;
+        int stage = 0;
+        int first = -1;
+    };
+    // A subtree shared by several parents becomes one node wherever it reads the same arguments
+    auto flattened = std::map<std::pair<const OperationBase*, std::vector<Source>>, int>();
+    auto stack = std::vector<Frame>();
+    stack.push_back({ &operation, std::move(arguments), 0, -1 });
+    int returned = -1;
+
+    while (!stack.empty())
+    {
+        auto& frame = stack.back();
+        const auto children = frame.operation->children();
+        const auto child = [&children](std::size_t i) { return static_cast<const Operation*>(children[i]); };
+        const auto kind = frame.operation->kind();
+        const bool binary = kind == OperationBase::Kind::Add || kind == OperationBase::Kind::Sub || kind == OperationBase::Kind::Comp;
+        const auto firstCount = binary ? static_cast<std::ptrdiff_t>(child(0)->inputCount()) : 0;
+
+        if (frame.stage == 0)
+        {
+            if (const auto it = flattened.find({ frame.operation, frame.arguments }); it != flattened.end())
+            {
+                returned = it->second;
+                stack.pop_back();
+                continue;
+            }
+            if (binary)
+            {
+                ++frame.stage;
+                auto firstArguments = std::vector<Source>(frame.arguments.begin(), frame.arguments.begin() + firstCount);
+                stack.push_back({ child(0), std::move(firstArguments), 0, -1 });
+                continue;
+            }
+        }
+        else if (frame.stage == 1)
+        {
+            ++frame.stage;
+            frame.first = returned;
+            // In a comp the first result becomes the first argument of the second operation
+            auto secondArguments = kind == OperationBase::Kind::Comp ? std::vector<Source>{ { false, returned } } : std::vector<Source>();
+            secondArguments.insert(secondArguments.end(), frame.arguments.begin() + firstCount, frame.arguments.end());
+            stack.push_back({ child(1), std::move(secondArguments), 0, -1 });
+            continue;
+        }
+
+        int index = returned;
+        if (kind != OperationBase::Kind::Comp)
+        {
+            auto node = Node();
+            node.kind = kind;
+            if (binary)
+            {
+                node.first = { false, frame.first };
+                node.second = { false, returned };
+            }
+            else
+            {
+                node.first = frame.arguments.front();
+                if (kind == OperationBase::Kind::Scalar)
+                    node.scalar = static_cast<const Scalar&>(*frame.operation).scalar();
+            }
+            index = addNode(std::move(node));
+        }
+        flattened.emplace(std::make_pair(frame.operation, std::move(frame.arguments)), index);
+        returned = index;
+        stack.pop_back();
+    }
+    return returned;
+}
+
+
+int EvalSession::addNode(Node node)
+{
+    const int index = nodeCount();
+    const auto addUser = [&](const Source& source)
+    {
+        auto& users = source.fromInput ? m_inputUsers[static_cast<std::size_t>(source.index)]
+                                       : m_nodes[static_cast<std::size_t>(source.index)].users;
+        users.push_back(index);
+    };
+    addUser(node.first);
+    if (node.kind == OperationBase::Kind::Add || node.kind == OperationBase::Kind::Sub)
+        addUser(node.second);
+    m_nodes.push_back(std::move(node));
+    return index;
+}
+
+
+void EvalSession::setInput(int slot, Operation::T value)
+{
+    if (slot < 0 || slot >= inputCount())
+        throw std::out_of_range("Input #" + std::to_string(slot) + " doesn't exist");
+    if (value.size() != m_inputs.front().size())
+        throw std::invalid_argument("All input matrices must have the same size");
+
+    auto& input = m_inputs[static_cast<std::size_t>(slot)];
+    if (sameValues(input, value))
+        return;
+    input = std::move(value);
+    for (const int user : m_inputUsers[static_cast<std::size_t>(slot)])
+        m_nodes[static_cast<std::size_t>(user)].pending = true;
+}
+
+
+int EvalSession::recompute()
+{
+    int recomputed = 0;
+    // Nodes come after the nodes they read, so one pass in order sees every change
+    for (std::size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        auto& node = m_nodes[i];
+        if (!node.pending)
+            continue;
+
+        auto value = Operation::T(0);
+        try
+        {
+            value = computeNode(node);
+        }
+        catch (...)
+        {
+            // Everything that depends on the failed node is out of date as well
+            for (std::size_t j = i; j < m_nodes.size(); ++j)
+            {
+                if (m_nodes[j].pending)
+                {
+                    for (const int user : m_nodes[j].users)
+                        m_nodes[static_cast<std::size_t>(user)].pending = true;
+                }
+            }
+            throw;
+        }
+        ++recomputed;
+
+        const bool changed = !node.computed || !sameValues(node.value, value);
+        node.value = std::move(value);
+        node.pending = false;
+        node.computed = true;
+        if (changed)
+        {
+            for (const int user : node.users)
+                m_nodes[static_cast<std::size_t>(user)].pending = true;
+        }
+    }
+    return recomputed;
+}
+
+
+Operation::T EvalSession::computeNode(const Node& node) const
+{
+    switch (node.kind)
+    {
+    case OperationBase::Kind::Transpose: return valueOf(node.first).Transpose();
+    case OperationBase::Kind::Scalar: return valueOf(node.first) * node.scalar;
+    case OperationBase::Kind::Add: return valueOf(node.first) + valueOf(node.second);
+    case OperationBase::Kind::Sub: return valueOf(node.first) - valueOf(node.second);
+    default: return valueOf(node.first);    // identity, comp never becomes a node
+    }
+}
+
+
+const Operation::T& EvalSession::result() const
+{
+    const auto& root = m_nodes[static_cast<std::size_t>(m_root)];
+    if (!root.computed || root.pending)
+        throw std::logic_error("The session has pending changes, call recompute() first");
+    return root.value;
+}
+
+
+const Operation::T& EvalSession::valueOf(const Source& source) const
+{
+    return source.fromInput ? m_inputs[static_cast<std::size_t>(source.index)]
+                            : m_nodes[static_cast<std::size_t>(source.index)].value;
+}
@@ -6,11 +6,19 @@
 #include "Identity.h"
 #include "Transpose.h"
 #include "Scalar.h"
+#include "Profiler.h"
+#include "EvalPipeline.h"
+#include "OperationLibrary.h"
+#include "MemoryFootprint.h"
+#include "MemoryTracker.h"
 
 #include <iostream>
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 
 FunctionCalculator::FunctionCalculator(std::istream& istr, std::ostream& ostr)
     : m_actions(createActions()), m_operations(createOperations()), m_istr(istr), m_ostr(ostr)
@@ -51,38 +59,17 @@ void FunctionCalculator::eval(std::istream& in)
     try {
         if (auto index = readOperationIndex(in); index)
         {
-            const auto& operation = m_operations[*index];
-            int inputCount = operation->inputCount();
-            int size = 0;
-            in >> size;
-			if (size <= 0 || size > 5)
-			{
-                in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-				throw std::out_of_range("Invalid input: plase enter size between 1 - 5");
-			}
-            if (in.peek() != '\n') {
-                in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-				throw std::invalid_argument("to meny argument for the action");
-            }
-            
-            auto matrixVec = std::vector<Operation::T>();
-            if (inputCount > 1)
-                m_ostr << "\nPlease enter " << inputCount << " matrices:\n";
-
-            for (int i = 0; i < inputCount; ++i)
-            {
-                auto input = Operation::T(size);
-                m_ostr << "\nEnter a " << size << "x" << size << " matrix:\n";
-                
-                in >> input;
-				if (in.peek() != '\n') {
-                    in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-					throw std::invalid_argument("to many items for the matrix");
-				}
-                matrixVec.push_back(input);
-
-            }
-			auto result = operation->compute(matrixVec);
+            const auto operation = m_operations.at(*index);
+            const int size = readMatrixSize(in);
+            MemoryFootprint::checkEvalLimit(*operation, size, m_evalLimit);
+            auto matrixVec = readMatrices(in, size, operation->inputCount());
+
+            // Through computeInto the evaluation holds exactly what evalBytes predicted
+            MemoryTracker::resetPeak();
+            const auto views = std::vector<Operation::ConstRef>(matrixVec.begin(), matrixVec.end());
+            auto result = Operation::T(size);
+            auto scratch = Scratch(operation->scratchBytes(size));
+			operation->computeInto(views, result, scratch);
             m_ostr << "\n";
             operation->print(m_ostr, matrixVec);
 			m_ostr << " = \n" << result;
@@ -99,6 +86,192 @@ void FunctionCalculator::eval(std::istream& in)
 }
 
 
+int FunctionCalculator::readMatrixSize(std::istream& in)
+{
+    int size = 0;
+    in >> size;
+	if (size <= 0 || size > 5)
+	{
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		throw std::out_of_range("Invalid input: plase enter size between 1 - 5");
+	}
+    if (in.peek() != '\n') {
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		throw std::invalid_argument("to meny argument for the action");
+    }
+    return size;
+}
+
+
+std::vector<Operation::T> FunctionCalculator::readMatrices(std::istream& in, int size, int inputCount)
+{
+    auto matrixVec = std::vector<Operation::T>();
+    if (inputCount > 1)
+        m_ostr << "\nPlease enter " << inputCount << " matrices:\n";
+
+    for (int i = 0; i < inputCount; ++i)
+    {
+        auto input = Operation::T(size);
+        m_ostr << "\nEnter a " << size << "x" << size << " matrix:\n";
+
+        in >> input;
+		if (in.peek() != '\n') {
+            in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+			throw std::invalid_argument("to many items for the matrix");
+		}
+        matrixVec.push_back(input);
+    }
+    return matrixVec;
+}
+
+
+void FunctionCalculator::profile(std::istream& in)
+{
+    if (auto index = readOperationIndex(in); index)
+    {
+        const auto operation = m_operations.at(*index);
+        const int size = readMatrixSize(in);
+        MemoryFootprint::checkEvalLimit(*operation, size, m_evalLimit);
+        auto matrixVec = readMatrices(in, size, operation->inputCount());
+
+        auto& profiler = Profiler::instance();
+        profiler.start();
+        auto result = Operation::T(0);
+        try
+        {
+            result = operation->compute(matrixVec);
+        }
+        catch (...)
+        {
+            profiler.stop();
+            throw;
+        }
+        profiler.stop();
+
+        m_ostr << "\n";
+        operation->print(m_ostr, matrixVec);
+        m_ostr << " = \n" << result << "\nProfile:\n";
+        profiler.printTree(m_ostr, *operation);
+    }
+}
+
+
+void FunctionCalculator::trace(std::istream& in)
+{
+    std::string path;
+    in >> path;
+    std::ofstream file(path);
+    if (!file) throw std::invalid_argument("Cannot open file: " + path);
+    Profiler::instance().writeChromeTrace(file);
+    m_ostr << "Trace of the last profile written to " << path << '\n';
+}
+
+
+void FunctionCalculator::batch(std::istream& in)
+{
+    if (auto index = readOperationIndex(in); index)
+    {
+        int size = 0;
+        int count = 0;
+        in >> size >> count;
+        if (in.fail() || size <= 0 || size > 5 || count <= 0)
+        {
+            in.clear();
+            in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            throw std::out_of_range("Invalid input: plase enter size between 1 - 5 and a positive count");
+        }
+
+        const auto operation = m_operations.at(*index);
+        auto pipeline = EvalPipeline(*operation, size, {});
+        // Every evaluator holds a set and its own scratch at the same time
+        MemoryFootprint::checkEvalLimit(*operation, size, m_evalLimit, pipeline.workers());
+        m_ostr << "\nEnter " << count << " sets of " << operation->inputCount() << " "
+               << size << "x" << size << " matrices, one matrix per line:\n";
+        const auto stats = pipeline.run(in, m_ostr, count);
+
+        const auto ms = [](std::int64_t ns) { return static_cast<double>(ns) / 1e6; };
+        m_ostr << "\n" << stats.sets << " sets (" << stats.errors << " errors) in " << ms(stats.totalNs) << " ms"
+               << " - parse " << ms(stats.parseNs) << " ms, compute " << ms(stats.computeNs)
+               << " ms on " << stats.workers << " threads (" << stats.pinned << " pinned), format " << ms(stats.formatNs) << " ms\n";
+    }
+}
+
+
+void FunctionCalculator::mem()
+{
+    const auto operations = m_operations.snapshot();
+    auto total = MemoryFootprint();
+    m_ostr << "\nMemory of the operations (nodes, bytes, evaluation of 5x5 matrices):\n";
+    for (std::size_t i = 0; i < operations->size(); ++i)
+    {
+        const auto& operation = *(*operations)[i];
+        const auto footprint = MemoryFootprint::of(operation);
+        total.add(operation);
+        m_ostr << i << ".\t" << footprint.nodes() << "\t" << footprint.bytes() << "\t"
+               << MemoryFootprint::evalBytes(operation, 5) << '\n';
+    }
+    m_ostr << "All operations: " << total.nodes() << " distinct nodes, " << total.bytes() << " bytes, list "
+           << operations->capacity() * sizeof(std::shared_ptr<Operation>) << " bytes\n"
+           << "Matrices and scratch: " << MemoryTracker::live() << " bytes live, "
+           << MemoryTracker::peak() << " bytes peak since the last eval\n"
+           << "Evaluation limit: ";
+    if (m_evalLimit == 0)
+        m_ostr << "none\n";
+    else
+        m_ostr << m_evalLimit << " bytes\n";
+}
+
+
+void FunctionCalculator::limit(std::istream& in)
+{
+    long long bytes = 0;
+    if (!(in >> bytes) || bytes < 0)
+    {
+        in.clear();
+        in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        throw std::invalid_argument("Invalid input: expected a number of bytes (0 for no limit)");
+    }
+    m_evalLimit = static_cast<std::size_t>(bytes);
+}
+
+
+void FunctionCalculator::save(std::istream& in)
+{
+    std::string path;
+    in >> path;
+    OperationLibrary::save(path, *m_operations.snapshot());
+    m_ostr << m_operations.size() << " operations saved to " << path << '\n';
+}
+
+
+void FunctionCalculator::load(std::istream& in)
+{
+    std::string path;
+    in >> path;
+    loadLibrary(path);
+    m_ostr << m_operations.size() << " operations loaded from " << path << '\n';
+}
+
+
+void FunctionCalculator::loadLibrary(const std::string& path)
+{
+    auto operations = OperationLibrary::load(path);
+    if (std::cmp_greater(operations.size(), maxOperationSize))
+    {
+        throw std::out_of_range("Library holds " + std::to_string(operations.size())
+            + " operations, more than the maximum of " + std::to_string(maxOperationSize));
+    }
+    m_operations.assign(std::move(operations));
+    // The list grows to fit the library, never past the maximum
+    m_operationSize = std::max(m_operationSize, static_cast<int>(m_operations.size()));
+    if (!m_isMaxFunc)
+    {
+        m_operationSize = maxOperationSize;
+        m_isMaxFunc = true;
+    }
+}
+
+
 void FunctionCalculator::del(std::istream& in)
 {
 	
@@ -108,7 +281,7 @@ void FunctionCalculator::del(std::istream& in)
             in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
             throw std::invalid_argument("to meny argument for the action");
         }
-        m_operations.erase(m_operations.begin() + *i);
+        m_operations.erase(*i);
     }
 }
 
@@ -134,18 +307,25 @@ void FunctionCalculator::exit()
 void FunctionCalculator::printOperations() const
 {
     m_ostr << "List of available matrix operations:\n";
-    for (decltype(m_operations.size()) i = 0; i < m_operations.size(); ++i)
+    const auto operations = m_operations.snapshot();
+    for (decltype(operations->size()) i = 0; i < operations->size(); ++i)
     {
         m_ostr << i << ". ";
-        m_operations[i]->print(m_ostr,true);
+        (*operations)[i]->print(m_ostr,true);
         m_ostr << '\n';
     }
     m_ostr << '\n';
-    m_ostr << "Number of operations: " << m_operations.size() << "/" << m_operationSize << '\n' << '\n';
+    m_ostr << "Number of operations: " << operations->size() << "/" << m_operationSize << '\n' << '\n';
 }
 
 
-std::optional<int> FunctionCalculator::readOperationIndex(std::istream& in) const
+bool FunctionCalculator::operationListFull() const
+{
+    return std::cmp_greater_equal(m_operations.size(), m_operationSize);
+}
+
+
+std::optional<std::size_t> FunctionCalculator::readOperationIndex(std::istream& in) const
 {
     int i = 0;
 	in >> i;
@@ -155,12 +335,12 @@ std::optional<int> FunctionCalculator::readOperationIndex(std::istream& in) cons
         throw std::invalid_argument("Invalid input: expected an integer for operation index");
     }
 
-    if (i < 0 || i >= static_cast<int>(m_operations.size())) {
+    if (i < 0 || std::cmp_greater_equal(i, m_operations.size())) {
 		in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         throw std::out_of_range("Operation index out of range");
     }
 
-    return i;
+    return static_cast<std::size_t>(i);
 }
 
 FunctionCalculator::Action FunctionCalculator::readAction(std::istream& in) const {
@@ -188,7 +368,7 @@ void FunctionCalculator::runAction(Action action, std::istream& in)
             break;
 
         case Action::Add: 
-			if (m_operations.size() >= m_operationSize)
+			if (operationListFull())
 			{
                 in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 				throw std::out_of_range("Operation list is full");
@@ -197,7 +377,7 @@ void FunctionCalculator::runAction(Action action, std::istream& in)
             break;
 
         case Action::Sub:
-            if (m_operations.size() >= m_operationSize) {
+            if (operationListFull()) {
                 in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 				throw std::out_of_range("Operation list is full");
             }
@@ -205,7 +385,7 @@ void FunctionCalculator::runAction(Action action, std::istream& in)
             break;
 
         case Action::Comp:    
-			if (m_operations.size() >= m_operationSize) {
+			if (operationListFull()) {
                 in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 				throw std::out_of_range("Operation list is full");
 			}
@@ -225,7 +405,7 @@ void FunctionCalculator::runAction(Action action, std::istream& in)
             break;
 
         case Action::Scal:     
-			if (m_operations.size() >= m_operationSize) {
+			if (operationListFull()) {
                 in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 				throw std::out_of_range("Operation list is full");
 			}
@@ -239,6 +419,34 @@ void FunctionCalculator::runAction(Action action, std::istream& in)
 		case Action::Resize:
 			setOperationSize(in);
 			break;
+
+        case Action::Profile:
+            profile(in);
+            break;
+
+        case Action::Trace:
+            trace(in);
+            break;
+
+        case Action::Batch:
+            batch(in);
+            break;
+
+        case Action::Save:
+            save(in);
+            break;
+
+        case Action::Load:
+            load(in);
+            break;
+
+        case Action::Mem:
+            mem();
+            break;
+
+        case Action::Limit:
+            limit(in);
+            break;
     }
 }
 
@@ -301,6 +509,43 @@ FunctionCalculator::ActionMap FunctionCalculator::createActions() const
             "resize",
             " - resize the operation list",
             Action::Resize
+        },
+        {
+            "profile",
+            " num n - like eval, and prints the operation tree with the calls, time and "
+			"allocations of every node",
+            Action::Profile
+        },
+        {
+            "trace",
+            " path - write the last profile as a Chrome trace JSON file",
+            Action::Trace
+        },
+        {
+            "batch",
+            " num n count - compute function #num on count sets of nn matrices, reading, "
+			"computing and printing in parallel",
+            Action::Batch
+        },
+        {
+            "save",
+            " path - save the operation list to a binary library file",
+            Action::Save
+        },
+        {
+            "load",
+            " path - replace the operation list with the one saved in a library file",
+            Action::Load
+        },
+        {
+            "mem",
+            " - show the memory of every operation, of the matrices and the evaluation limit",
+            Action::Mem
+        },
+        {
+            "limit",
+            " bytes - reject evaluations predicted to need more than bytes (0 removes the limit)",
+            Action::Limit
         }
     };
 }
@@ -347,7 +592,7 @@ void FunctionCalculator::getOperationSize()
 		m_istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 		throw std::invalid_argument("Invalid input: expected an integer for operation size");
 	}
-	if (m_operationSize < 2 || m_operationSize > 100)
+	if (m_operationSize < minOperationSize || m_operationSize > maxOperationSize)
 	{
 		m_istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 		throw std::out_of_range("Invalid input: please enter size between 2 - 100");
@@ -359,7 +604,7 @@ void FunctionCalculator::setOperationSize(std::istream& in)
 {
     int newSize = 0;
     in >> newSize;
-    if (newSize > m_operations.size()) {
+    if (std::cmp_greater(newSize, m_operations.size())) {
         m_operationSize = newSize;
     }
     else {
@@ -368,9 +613,7 @@ void FunctionCalculator::setOperationSize(std::istream& in)
         char answer;
         m_istr >> answer;
         if (answer == 'y' || answer == 'Y') {
-            for (int i = m_operationSize - 1; i >= newSize; --i) {
-                m_operations.pop_back();
-            }
+            m_operations.truncate(static_cast<std::size_t>(std::max(newSize, 0)));
             m_operationSize = newSize;
         }
         else {
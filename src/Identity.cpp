@@ -1,16 +1,42 @@
 #include "Identity.h"
+#include "Profiler.h"
 
+#include <algorithm>
 #include <iostream>
 
 
-Operation::T Identity::compute(const std::vector<T>& input) const
+template <typename M>
+typename BasicIdentity<M>::T BasicIdentity<M>::compute(const std::vector<T>& input) const
 {
+    PROFILE_OPERATION(*this);
     return input.front();
 }
 
 
-void Identity::print(std::ostream& ostr, bool first_print) const
+template <typename M>
+typename BasicIdentity<M>::S BasicIdentity<M>::computeStructured(const std::vector<S>& input) const
+{
+    PROFILE_OPERATION(*this);
+    return input.front();
+}
+
+
+template <typename M>
+std::optional<EvalFault> BasicIdentity<M>::tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+    PROFILE_OPERATION(*this);
+    (void)scratch;
+    std::copy_n(input.front().data(), out.count(), out.data());
+    return std::nullopt;
+}
+
+
+template <typename M>
+void BasicIdentity<M>::print(std::ostream& ostr, bool first_print) const
 {
     (void)first_print; // Cast to void to avoid unused parameter warning
     ostr << "id";
 }
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicIdentity);
@@ -0,0 +1,54 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OOP2_HAS_MMAP 1
+#endif
+
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef OOP2_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::invalid_argument("File not found: " + path);
+    struct stat info {};
+    if (::fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void* address = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED)
+        {
+            m_data = static_cast<const std::byte*>(address);
+            m_size = static_cast<std::size_t>(info.st_size);
+            m_mapped = true;
+        }
+    }
+    ::close(fd);
+    if (m_mapped)
+        return;
+#endif
+
+    auto file = std::ifstream(path, std::ios::binary | std::ios::ate);
+    if (!file)
+        throw std::invalid_argument("File not found: " + path);
+    m_buffer.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size()));
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef OOP2_HAS_MMAP
+    if (m_mapped)
+        ::munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+}
@@ -0,0 +1,48 @@
+#include "MemoryFootprint.h"
+
+#include <stdexcept>
+#include <string>
+
+
+void MemoryFootprint::add(const OperationBase& root)
+{
+    // Iterative, so a very deep comp chain cannot overflow the stack
+    auto pending = std::vector<const OperationBase*>{ &root };
+    while (!pending.empty())
+    {
+        const auto* node = pending.back();
+        pending.pop_back();
+        if (!m_seen.insert(node).second)
+            continue;
+        m_bytes += node->objectBytes() + controlBlockBytes;
+        for (const auto* child : node->children())
+            pending.push_back(child);
+    }
+}
+
+
+MemoryFootprint MemoryFootprint::of(const OperationBase& root)
+{
+    auto footprint = MemoryFootprint();
+    footprint.add(root);
+    return footprint;
+}
+
+
+std::size_t MemoryFootprint::evalBytes(const Operation& operation, int size)
+{
+    const auto matrixBytes = static_cast<std::size_t>(size) * static_cast<std::size_t>(size) * sizeof(Operation::T::value_type);
+    const auto inputs = static_cast<std::size_t>(operation.inputCount());
+    return (inputs + 1) * matrixBytes + inputs * sizeof(Operation::ConstRef) + operation.scratchBytes(size);
+}
+
+
+void MemoryFootprint::checkEvalLimit(const Operation& operation, int size, std::size_t limit, int evaluations)
+{
+    const auto needed = evalBytes(operation, size) * static_cast<std::size_t>(evaluations);
+    if (limit != 0 && needed > limit)
+    {
+        throw std::length_error("The evaluation needs " + std::to_string(needed) + " bytes, over the limit of "
+                                + std::to_string(limit) + " bytes");
+    }
+}
@@ -1,13 +1,73 @@
 #include "Operation.h"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 
 
-void Operation::print(std::ostream& ostr, const std::vector<T>& input) const
+template <typename M>
+void BasicOperation<M>::print(std::ostream& ostr, const std::vector<T>& input) const
 {
 	print(ostr);
-	for (int i = 0; i < inputCount(); ++i)
+	for (int i = 0; i < this->inputCount(); ++i)
 	{
 		ostr << "(\n" << input[i] << ")";
 	}
 }
+
+
+template <typename M>
+typename BasicOperation<M>::S BasicOperation<M>::computeStructured(const std::vector<S>& input) const
+{
+	auto dense = std::vector<T>();
+	for (const auto& matrix : input)
+		dense.push_back(matrix.toDense());
+	return S(compute(dense));
+}
+
+
+template <typename M>
+std::optional<EvalFault> BasicOperation<M>::tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+	(void)scratch;
+	auto dense = std::vector<T>();
+	for (const auto& matrix : input)
+	{
+		dense.emplace_back(matrix.size(), typename M::value_type{});
+		std::copy_n(matrix.data(), matrix.count(), dense.back().data());
+	}
+	try
+	{
+		const auto result = compute(dense);
+		std::copy_n(result.data(), out.count(), out.data());
+	}
+	catch (const std::out_of_range&)
+	{
+		return EvalFault{ this, std::nullopt };
+	}
+	return std::nullopt;
+}
+
+
+template <typename M>
+void BasicOperation<M>::computeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+	if (tryComputeInto(input, out, scratch))
+		throw std::out_of_range("Matrix value is out of range");
+}
+
+
+template <typename M>
+std::expected<typename BasicOperation<M>::T, EvalFault> BasicOperation<M>::tryCompute(const std::vector<T>& input) const
+{
+	const int size = input.empty() ? 0 : input.front().size();
+	auto views = std::vector<ConstRef>(input.begin(), input.end());
+	auto result = T(size);
+	auto scratch = Scratch(scratchBytes(size));
+	if (auto fault = tryComputeInto(views, result, scratch))
+		return std::unexpected(*fault);
+	return result;
+}
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicOperation);
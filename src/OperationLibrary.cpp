@@ -0,0 +1,151 @@
+#include "OperationLibrary.h"
+#include "MappedFile.h"
+#include "Add.h"
+#include "Comp.h"
+#include "Identity.h"
+#include "Scalar.h"
+#include "Sub.h"
+#include "Transpose.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+
+namespace
+{
+    template <typename Record>
+    Record readRecord(const std::byte* data)
+    {
+        auto record = Record();
+        std::memcpy(&record, data, sizeof(Record));
+        return record;
+    }
+}
+
+
+void OperationLibrary::save(const std::string& path, const OperationList& operations)
+{
+    auto records = std::vector<NodeRecord>();
+    auto ids = std::unordered_map<const OperationBase*, std::uint32_t>();
+    auto structural = std::map<std::tuple<std::uint8_t, std::int64_t, std::uint32_t, std::uint32_t>, std::uint32_t>();
+
+    // Iterative post-order walk, the chains can be far deeper than the call stack allows
+    const auto assignId = [&](const OperationBase* root)
+    {
+        auto stack = std::vector<std::pair<const OperationBase*, bool>>{ { root, false } };
+        while (!stack.empty())
+        {
+            const auto [node, expanded] = stack.back();
+            stack.pop_back();
+            if (ids.contains(node))
+                continue;
+
+            const auto children = node->children();
+            if (!expanded)
+            {
+                stack.emplace_back(node, true);
+                for (auto it = children.rbegin(); it != children.rend(); ++it)
+                    stack.emplace_back(*it, false);
+                continue;
+            }
+
+            auto record = NodeRecord{};
+            record.kind = static_cast<std::uint8_t>(node->kind());
+            record.inputCount = node->inputCount();
+            if (children.size() == 2)
+            {
+                record.first = ids.at(children[0]);
+                record.second = ids.at(children[1]);
+            }
+            if (node->kind() == OperationBase::Kind::Scalar)
+                record.scalar = static_cast<const Scalar*>(node)->scalar();
+
+            const auto key = std::make_tuple(record.kind, record.scalar, record.first, record.second);
+            const auto [it, inserted] = structural.emplace(key, static_cast<std::uint32_t>(records.size()));
+            if (inserted)
+                records.push_back(record);
+            ids.emplace(node, it->second);
+        }
+        return ids.at(root);
+    };
+
+    auto roots = std::vector<std::uint32_t>();
+    for (const auto& operation : operations)
+        roots.push_back(assignId(operation.get()));
+
+    auto file = std::ofstream(path, std::ios::binary);
+    if (!file)
+        throw std::invalid_argument("Cannot open file: " + path);
+
+    auto header = Header{};
+    std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+    header.version = fileVersion;
+    header.nodeCount = static_cast<std::uint32_t>(records.size());
+    header.rootCount = static_cast<std::uint32_t>(roots.size());
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(NodeRecord)));
+    file.write(reinterpret_cast<const char*>(roots.data()), static_cast<std::streamsize>(roots.size() * sizeof(std::uint32_t)));
+    if (!file)
+        throw std::runtime_error("Failed writing file: " + path);
+}
+
+
+OperationLibrary::OperationList OperationLibrary::load(const std::string& path)
+{
+    const auto file = MappedFile(path);
+    const auto invalid = [&path] { return std::invalid_argument("Not a valid operation library: " + path); };
+
+    if (file.size() < sizeof(Header))
+        throw invalid();
+    const auto header = readRecord<Header>(file.data());
+    if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 || header.version != fileVersion)
+        throw invalid();
+    const auto expectedSize = sizeof(Header) + std::size_t{ header.nodeCount } * sizeof(NodeRecord)
+        + std::size_t{ header.rootCount } * sizeof(std::uint32_t);
+    if (file.size() != expectedSize)
+        throw invalid();
+
+    auto nodes = OperationList();
+    nodes.reserve(header.nodeCount);
+    const auto* recordData = file.data() + sizeof(Header);
+    for (std::uint32_t i = 0; i < header.nodeCount; ++i)
+    {
+        const auto record = readRecord<NodeRecord>(recordData + std::size_t{ i } * sizeof(NodeRecord));
+        const auto kind = static_cast<OperationBase::Kind>(record.kind);
+        const bool binary = kind == OperationBase::Kind::Add || kind == OperationBase::Kind::Sub || kind == OperationBase::Kind::Comp;
+        if (binary && (record.first >= i || record.second >= i))
+            throw invalid();
+        if (kind == OperationBase::Kind::Scalar && !std::in_range<int>(record.scalar))
+            throw invalid();
+
+        switch (kind)
+        {
+        case OperationBase::Kind::Identity: nodes.push_back(std::make_shared<Identity>()); break;
+        case OperationBase::Kind::Transpose: nodes.push_back(std::make_shared<Transpose>()); break;
+        case OperationBase::Kind::Scalar: nodes.push_back(std::make_shared<Scalar>(static_cast<int>(record.scalar))); break;
+        case OperationBase::Kind::Add: nodes.push_back(std::make_shared<Add>(nodes[record.first], nodes[record.second])); break;
+        case OperationBase::Kind::Sub: nodes.push_back(std::make_shared<Sub>(nodes[record.first], nodes[record.second])); break;
+        case OperationBase::Kind::Comp: nodes.push_back(std::make_shared<Comp>(nodes[record.first], nodes[record.second])); break;
+        default: throw invalid();
+        }
+        if (nodes.back()->inputCount() != record.inputCount)
+            throw invalid();
+    }
+
+    auto operations = OperationList();
+    operations.reserve(header.rootCount);
+    const auto* rootData = recordData + std::size_t{ header.nodeCount } * sizeof(NodeRecord);
+    for (std::uint32_t i = 0; i < header.rootCount; ++i)
+    {
+        const auto root = readRecord<std::uint32_t>(rootData + std::size_t{ i } * sizeof(std::uint32_t));
+        if (root >= header.nodeCount)
+            throw invalid();
+        operations.push_back(nodes[root]);
+    }
+    return operations;
+}
@@ -0,0 +1,78 @@
+#include "OperationRegistry.h"
+
+#include <stdexcept>
+#include <string>
+
+
+OperationRegistry::OperationRegistry(OperationList operations)
+    : m_current(std::make_shared<const State>(State{ std::move(operations), 0 }))
+{
+}
+
+
+OperationRegistry::Snapshot OperationRegistry::snapshot() const
+{
+    auto state = m_current.load(std::memory_order_acquire);
+    const auto* operations = &state->operations;
+    return Snapshot(std::move(state), operations);
+}
+
+
+std::shared_ptr<Operation> OperationRegistry::at(std::size_t index) const
+{
+    const auto operations = snapshot();
+    if (index >= operations->size())
+        throw std::out_of_range("Operation #" + std::to_string(index) + " doesn't exist");
+    return (*operations)[index];
+}
+
+
+std::size_t OperationRegistry::add(std::shared_ptr<Operation> operation)
+{
+    std::size_t index = 0;
+    update([&](OperationList& operations)
+    {
+        index = operations.size();
+        operations.push_back(std::move(operation));
+    });
+    return index;
+}
+
+
+void OperationRegistry::erase(std::size_t index)
+{
+    update([index](OperationList& operations)
+    {
+        if (index >= operations.size())
+            throw std::out_of_range("Operation #" + std::to_string(index) + " doesn't exist");
+        operations.erase(operations.begin() + static_cast<std::ptrdiff_t>(index));
+    });
+}
+
+
+void OperationRegistry::truncate(std::size_t size)
+{
+    update([size](OperationList& operations)
+    {
+        if (size < operations.size())
+            operations.resize(size);
+    });
+}
+
+
+void OperationRegistry::assign(OperationList operations)
+{
+    update([&operations](OperationList& current) { current = std::move(operations); });
+}
+
+
+template <typename Change>
+void OperationRegistry::update(Change change)
+{
+    const auto lock = std::lock_guard(m_writeMutex);
+    // Only writers store, and they hold the mutex, so a relaxed load sees the latest version
+    const auto current = m_current.load(std::memory_order_relaxed);
+    auto next = OperationList(current->operations);
+    change(next);
+    m_current.store(std::make_shared<const State>(State{ std::move(next), current->version + 1 }), std::memory_order_release);
+}
@@ -0,0 +1,185 @@
+#include "Profiler.h"
+#include "Operation.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+
+namespace
+{
+    // Nodes whose compute is currently running on this thread, innermost last
+    thread_local std::vector<const OperationBase*> t_callStack;
+
+    std::int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::string makeLabel(const OperationBase& operation)
+    {
+        constexpr std::size_t maxLength = 60;
+        auto label = std::ostringstream();
+        operation.print(label, true);
+        auto text = label.str();
+        if (text.size() > maxLength)
+            text = text.substr(0, maxLength - 3) + "...";
+        return text;
+    }
+
+    void writeJsonString(std::ostream& ostr, const std::string& text)
+    {
+        ostr << '"';
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                ostr << '\\';
+            ostr << (c == '\n' ? ' ' : c);
+        }
+        ostr << '"';
+    }
+}
+
+
+Profiler::Scope::Scope(const OperationBase& operation)
+    : m_operation(nullptr), m_startNs(0)
+{
+    if (!Profiler::instance().active())
+        return;
+    m_operation = &operation;
+    t_callStack.push_back(m_operation);
+    m_startNs = nowNs();
+}
+
+
+Profiler::Scope::~Scope()
+{
+    if (!m_operation)
+        return;
+    const auto endNs = nowNs();
+    t_callStack.pop_back();
+    Profiler::instance().record(*m_operation, m_startNs, endNs);
+}
+
+
+Profiler& Profiler::instance()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+
+void Profiler::start()
+{
+    const auto lock = std::scoped_lock(m_mutex);
+    m_stats.clear();
+    m_events.clear();
+    m_originNs = nowNs();
+    m_active = true;
+}
+
+
+void Profiler::stop()
+{
+    m_active = false;
+}
+
+
+const Profiler::NodeStats* Profiler::stats(const OperationBase& operation) const
+{
+    const auto lock = std::scoped_lock(m_mutex);
+    auto it = m_stats.find(&operation);
+    return it == m_stats.end() ? nullptr : &it->second;
+}
+
+
+void Profiler::matrixCreated(std::size_t bytes)
+{
+    if (!m_active || t_callStack.empty())
+        return;
+    const auto lock = std::scoped_lock(m_mutex);
+    auto& nodeStats = m_stats[t_callStack.back()];
+    nodeStats.bytesAllocated += static_cast<std::int64_t>(bytes);
+    ++nodeStats.matricesCreated;
+}
+
+
+#ifdef OOP2_PROFILING
+void profileMatrixCreated(std::size_t bytes)
+{
+    Profiler::instance().matrixCreated(bytes);
+}
+#endif
+
+
+void Profiler::record(const OperationBase& operation, std::int64_t startNs, std::int64_t endNs)
+{
+    const auto lock = std::scoped_lock(m_mutex);
+    auto& nodeStats = m_stats[&operation];
+    if (nodeStats.calls == 0)
+        nodeStats.label = makeLabel(operation);
+    ++nodeStats.calls;
+    nodeStats.wallNs += endNs - startNs;
+    m_events.push_back({ &operation, startNs - m_originNs, endNs - startNs,
+        std::hash<std::thread::id>{}(std::this_thread::get_id()) });
+}
+
+
+void Profiler::printTree(std::ostream& ostr, const OperationBase& root) const
+{
+    if (!compiledIn())
+    {
+        ostr << "Profiling is not compiled in (configure with -DOOP2_PROFILING=ON)\n";
+        return;
+    }
+    printNode(ostr, root, 0, false);
+}
+
+
+void Profiler::printNode(std::ostream& ostr, const OperationBase& operation, int depth, bool folded) const
+{
+    ostr << std::string(static_cast<std::size_t>(depth) * 2, ' ');
+    operation.print(ostr, true);
+    if (const auto* nodeStats = stats(operation); nodeStats)
+    {
+        ostr << "  [calls " << nodeStats->calls
+             << ", " << static_cast<double>(nodeStats->wallNs) / 1000.0 << " us"
+             << ", " << nodeStats->matricesCreated << " matrices"
+             << ", " << nodeStats->bytesAllocated << " bytes]";
+    }
+    else if (folded)
+    {
+        ostr << "  [folded into the comp above]";
+    }
+    else
+    {
+        ostr << "  [not called]";
+    }
+    ostr << '\n';
+
+    // A comp that ran its folded form never calls the stages below it
+    const bool childrenFolded = folded || operation.foldsChildren();
+    for (const auto* child : operation.children())
+        printNode(ostr, *child, depth + 1, childrenFolded);
+}
+
+
+void Profiler::writeChromeTrace(std::ostream& ostr) const
+{
+    const auto lock = std::scoped_lock(m_mutex);
+    ostr << "{\"traceEvents\":[";
+    for (decltype(m_events.size()) i = 0; i < m_events.size(); ++i)
+    {
+        const auto& event = m_events[i];
+        ostr << (i == 0 ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(ostr, m_stats.at(event.operation).label);
+        ostr << ",\"cat\":\"compute\",\"ph\":\"X\",\"pid\":1"
+             << ",\"tid\":" << event.thread % 100000
+             << ",\"ts\":" << static_cast<double>(event.startNs) / 1000.0
+             << ",\"dur\":" << static_cast<double>(event.durationNs) / 1000.0 << '}';
+    }
+    ostr << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
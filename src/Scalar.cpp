@@ -1,22 +1,51 @@
 #include "Scalar.h"
+#include "Profiler.h"
 
+#include <algorithm>
 #include <iostream>
 
 
-Scalar::Scalar(int scalar)
+template <typename M>
+BasicScalar<M>::BasicScalar(Value scalar)
  : m_scalar(scalar)
 {
 }
 
 
-Operation::T Scalar::compute(const std::vector<T>& input) const
+template <typename M>
+typename BasicScalar<M>::T BasicScalar<M>::compute(const std::vector<T>& input) const
 {
+    PROFILE_OPERATION(*this);
     return input.front() * m_scalar;
 }
 
 
-void Scalar::print(std::ostream& ostr, bool first_print) const
+template <typename M>
+typename BasicScalar<M>::S BasicScalar<M>::computeStructured(const std::vector<S>& input) const
+{
+    PROFILE_OPERATION(*this);
+    return input.front() * m_scalar;
+}
+
+
+template <typename M>
+std::optional<EvalFault> BasicScalar<M>::tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+    PROFILE_OPERATION(*this);
+    (void)scratch;
+    std::copy_n(input.front().data(), out.count(), out.data());
+    if (const auto fault = detail::tryScaleValues<Value, typename M::policy_type>(out.data(), out.count(), m_scalar))
+        return makeFault(*this, out.size(), *fault);
+    return std::nullopt;
+}
+
+
+template <typename M>
+void BasicScalar<M>::print(std::ostream& ostr, bool first_print) const
 {
     (void)first_print; // Cast to void to avoid unused parameter warning
     ostr << "scal " << m_scalar;
 }
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicScalar);
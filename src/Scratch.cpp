@@ -0,0 +1,23 @@
+#include "Scratch.h"
+
+
+Scratch::Scratch(std::size_t bytes)
+{
+    reserve(bytes);
+}
+
+
+void Scratch::reserve(std::size_t bytes)
+{
+    bytes = bytesFor<std::byte>(bytes);
+    if (bytes <= m_capacity)
+        return;
+    // The old block goes first so both are never held at once; should the allocation
+    // throw, the arena is left empty instead of describing the freed block
+    m_block.reset();
+    m_capacity = 0;
+    m_used = 0;
+    m_block = { static_cast<std::byte*>(::operator new[](bytes, std::align_val_t{ alignment })), AlignedDelete{ bytes } };
+    MemoryTracker::allocated(bytes);
+    m_capacity = bytes;
+}
@@ -0,0 +1,131 @@
+#include "Topology.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    // Used when the system does not report its L2 size
+    constexpr std::size_t defaultL2Bytes = 1 << 20;
+
+    // Parses a kernel CPU list such as "0-3,8,10-11"
+    std::vector<int> parseCpuList(const std::string& text)
+    {
+        auto cpus = std::vector<int>();
+        auto in = std::istringstream(text);
+        for (std::string range; std::getline(in, range, ',');)
+        {
+            const auto dash = range.find('-');
+            try
+            {
+                const int first = std::stoi(range.substr(0, dash));
+                const int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu)
+                    cpus.push_back(cpu);
+            }
+            catch (const std::exception&)
+            {
+                // Trailing newline or an empty list
+            }
+        }
+        return cpus;
+    }
+
+    std::vector<std::vector<int>> readNodes()
+    {
+        auto nodes = std::vector<std::pair<int, std::vector<int>>>();
+        auto error = std::error_code();
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+        {
+            const auto name = entry.path().filename().string();
+            if (name.rfind("node", 0) != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                continue;
+            auto file = std::ifstream(entry.path() / "cpulist");
+            auto text = std::string();
+            std::getline(file, text);
+            if (auto cpus = parseCpuList(text); !cpus.empty())
+                nodes.emplace_back(std::stoi(name.substr(4)), std::move(cpus));
+        }
+        std::ranges::sort(nodes);
+
+        auto result = std::vector<std::vector<int>>();
+        for (auto& node : nodes)
+            result.push_back(std::move(node.second));
+        if (result.empty())
+        {
+            result.emplace_back();
+            for (int cpu = 0; cpu < std::max(1, static_cast<int>(std::thread::hardware_concurrency())); ++cpu)
+                result.back().push_back(cpu);
+        }
+        return result;
+    }
+
+    std::size_t readL2Bytes()
+    {
+#ifdef __linux__
+        if (const long bytes = ::sysconf(_SC_LEVEL2_CACHE_SIZE); bytes > 0)
+            return static_cast<std::size_t>(bytes);
+#endif
+        // Reported as for example "2048K"
+        auto file = std::ifstream("/sys/devices/system/cpu/cpu0/cache/index2/size");
+        std::size_t size = 0;
+        char unit = 0;
+        if (file >> size && size > 0)
+        {
+            file >> unit;
+            return size * (unit == 'M' ? 1 << 20 : unit == 'K' ? 1 << 10 : 1);
+        }
+        return defaultL2Bytes;
+    }
+}
+
+
+Topology::Topology()
+    : m_nodes(readNodes()), m_l2Bytes(readL2Bytes())
+{
+}
+
+
+const Topology& Topology::current()
+{
+    static const auto topology = Topology();
+    return topology;
+}
+
+
+int Topology::nodeForWorker(int worker) const
+{
+    return worker % nodeCount();
+}
+
+
+int Topology::cpuForWorker(int worker) const
+{
+    const auto& nodeCpus = cpus(nodeForWorker(worker));
+    return nodeCpus[static_cast<std::size_t>(worker / nodeCount()) % nodeCpus.size()];
+}
+
+
+bool Topology::pinCurrentThread(int cpu)
+{
+#ifdef __linux__
+    auto set = cpu_set_t();
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
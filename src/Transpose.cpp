@@ -1,14 +1,49 @@
 #include "Transpose.h"
+#include "Profiler.h"
 
+#include <algorithm>
+#include <iostream>
 
-Operation::T Transpose::compute(const std::vector<T>& input) const
+
+template <typename M>
+typename BasicTranspose<M>::T BasicTranspose<M>::compute(const std::vector<T>& input) const
+{
+    PROFILE_OPERATION(*this);
+    return input.front().Transpose();
+}
+
+
+template <typename M>
+typename BasicTranspose<M>::S BasicTranspose<M>::computeStructured(const std::vector<S>& input) const
 {
+    PROFILE_OPERATION(*this);
     return input.front().Transpose();
 }
 
 
-void Transpose::print(std::ostream& ostr, bool first_print) const
+template <typename M>
+std::optional<EvalFault> BasicTranspose<M>::tryComputeInto(std::span<const ConstRef> input, Ref out, Scratch& scratch) const
+{
+    PROFILE_OPERATION(*this);
+    (void)scratch;
+    const auto& matrix = input.front();
+    for (int i = 0; i < out.size(); ++i)
+    {
+        for (int j = 0; j < out.size(); ++j)
+        {
+            out(i, j) = matrix(j, i);
+        }
+    }
+    return std::nullopt;
+}
+
+
+template <typename M>
+void BasicTranspose<M>::print(std::ostream& ostr, bool first_print) const
 {
     (void)first_print; // Cast to void to avoid unused parameter warning
     ostr << "tran";
 }
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicTranspose);
@@ -1,12 +1,23 @@
 #include "UnaryOperation.h"
 
 
-UnaryOperation::UnaryOperation()
+template <typename M>
+BasicUnaryOperation<M>::BasicUnaryOperation()
 {
 }
 
 
-int UnaryOperation::inputCount() const
+template <typename M>
+BasicUnaryOperation<M>::~BasicUnaryOperation()
+{
+}
+
+
+template <typename M>
+int BasicUnaryOperation<M>::inputCount() const
 {
 	return 1;
 }
+
+
+INSTANTIATE_FOR_MATRIX_TYPES(BasicUnaryOperation);
@@ -1,11 +1,61 @@
 #include "FunctionCalculator.h"
+#include "CalculatorServer.h"
+#include "OperationLibrary.h"
+#include "Identity.h"
+#include "Transpose.h"
 
+#include <csignal>
 #include <string>
 #include <iostream>
 
 
-int main()
+namespace
 {
-    FunctionCalculator(std::cin, std::cout).run();
+    CalculatorServer* runningServer = nullptr;
 
+    void stopServer(int)
+    {
+        if (runningServer)
+            runningServer->stop();
+    }
+
+    int serve(const std::string& socketPath, const char* library)
+    {
+        auto operations = library ? OperationLibrary::load(library)
+                                  : OperationLibrary::OperationList{ std::make_shared<Identity>(), std::make_shared<Transpose>() };
+        auto server = CalculatorServer(socketPath, std::move(operations));
+        runningServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        std::cerr << "Serving on " << socketPath << '\n';
+        server.run();
+        runningServer = nullptr;
+        return 0;
+    }
+}
+
+
+// Usage: oop2_ex03 [library]                  - interactive, starting with the operations saved in library
+//        oop2_ex03 --serve socket [library]   - serve requests on a Unix domain socket
+//        oop2_ex03 --client socket            - send every line of the standard input to a server
+int main(int argc, char* argv[])
+{
+    try
+    {
+        const auto mode = std::string(argc > 1 ? argv[1] : "");
+        if (mode == "--serve" && argc > 2)
+            return serve(argv[2], argc > 3 ? argv[3] : nullptr);
+        if (mode == "--client" && argc > 2)
+            return runCalculatorClient(argv[2], std::cin, std::cout) == 0 ? 0 : 2;
+
+        auto calculator = FunctionCalculator(std::cin, std::cout);
+        if (argc > 1)
+            calculator.loadLibrary(argv[1]);
+        calculator.run();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
 }